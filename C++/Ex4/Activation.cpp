@@ -7,6 +7,7 @@
  */
 
 #include "Activation.h"
+#include <algorithm>
 #include <iostream>
 #include <cmath>
 
@@ -54,14 +55,69 @@ Matrix Activation::operator()(Matrix& mat_input) const
     }
     else if (_actType == Softmax)
     {
-        float sum_exp = 0;
-        for (int index = 0; index < matrixSize(mat_input); index++)
+        // each column is a separate input vector of the batch
+        int rows = mat_input.getRows();
+        int cols = mat_input.getCols();
+        const float* input = mat_input.getData();
+        float* output = mat_with_active.getData();
+        for (int col = 0; col < cols; col++)
         {
-            float result = std::exp(mat_input[index]);
-            mat_with_active[index] = result;
-            sum_exp += result;
+            // shifted by the largest input so exp can't overflow (the shift cancels out in the ratio)
+            float max_input = input[col];
+            for (int row = 1; row < rows; row++)
+            {
+                max_input = std::max(max_input, input[(row * cols) + col]);
+            }
+            float sum_exp = 0;
+            for (int row = 0; row < rows; row++)
+            {
+                float result = std::exp(input[(row * cols) + col] - max_input);
+                output[(row * cols) + col] = result;
+                sum_exp += result;
+            }
+            float inverse_sum = 1 / sum_exp;
+            for (int row = 0; row < rows; row++)
+            {
+                output[(row * cols) + col] *= inverse_sum;
+            }
         }
-        mat_with_active = (1 / sum_exp) * mat_with_active;
     }
     return mat_with_active;
 }
+
+/**
+ * @brief backward pass
+ */
+Matrix Activation::backward(const Matrix& mat_output, const Matrix& mat_grad) const
+{
+    int rows = mat_output.getRows();
+    int cols = mat_output.getCols();
+    Matrix mat_input_grad (rows, cols);
+    const float* output = mat_output.getData();
+    const float* grad = mat_grad.getData();
+    float* input_grad = mat_input_grad.getData();
+    if (_actType == Relu)
+    {
+        for (int index = 0; index < matrixSize(mat_output); index++)
+        {
+            input_grad[index] = (output[index] > 0) ? grad[index] : 0;
+        }
+    }
+    else if (_actType == Softmax)
+    {
+        // per column: dx = y * (dy - sum(dy * y))
+        for (int col = 0; col < cols; col++)
+        {
+            float dot = 0;
+            for (int row = 0; row < rows; row++)
+            {
+                dot += grad[(row * cols) + col] * output[(row * cols) + col];
+            }
+            for (int row = 0; row < rows; row++)
+            {
+                input_grad[(row * cols) + col] = output[(row * cols) + col] * (grad[(row * cols) + col] - dot);
+            }
+        }
+    }
+    return mat_input_grad;
+}
@@ -43,10 +43,18 @@ public:
     ActivationType getActivationType() const {return _actType; }
 
     /**
-     * @brief operator ()
-     * @param mat_input: input matrix
+     * @brief operator () - softmax is applied to each column separately
+     * @param mat_input: input matrix (one input vector per column)
      * @return copy of input matrix after activation
      */
     Matrix operator()(Matrix& mat_input) const;
+
+    /**
+     * @brief backward pass - gradient of the loss by the activation input
+     * @param mat_output: output of operator () in the forward pass
+     * @param mat_grad: gradient of the loss by that output
+     * @return gradient by the input (same size)
+     */
+    Matrix backward(const Matrix& mat_output, const Matrix& mat_grad) const;
 };
 #endif //ACTIVATION_H
@@ -0,0 +1,225 @@
+/**
+ * @file Autotuner.cpp
+ * @author  Jonathan Birnbaum
+ * @date 08/06/2020
+ *
+ * @brief kernel autotuning implementation
+ */
+
+#include "Autotuner.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+/**
+ * @brief first word of the tuning file header
+ */
+#define TUNING_HOST_KEY "host_threads"
+
+/**
+ * @brief word before the cache sizes in the tuning file header
+ */
+#define TUNING_CACHE_KEY "cache_bytes"
+
+/**
+ * @brief candidate panel heights and column blocks (0 = whole input, no blocking)
+ */
+static const int panelCandidates[] = {4, 8, 16};
+static const int colBlockCandidates[] = {64, 256, 0};
+
+/**
+ * @brief number of hardware threads of this host (at least 1)
+ * @return thread count
+ */
+static unsigned int hostThreads()
+{
+    unsigned int threads = std::thread::hardware_concurrency();
+    return (threads == 0) ? 1 : threads;
+}
+
+/**
+ * @brief data cache sizes of this host, the blocking and panel height the tuning picks depend on them
+ * @return L1 data, L2 and L3 sizes in bytes (0 where the system doesn't report one)
+ */
+static std::array<long, TUNING_CACHE_LEVELS> hostCacheSizes()
+{
+    std::array<long, TUNING_CACHE_LEVELS> sizes = {0, 0, 0};
+#if defined(_SC_LEVEL1_DCACHE_SIZE) && defined(_SC_LEVEL2_CACHE_SIZE) && defined(_SC_LEVEL3_CACHE_SIZE)
+    const int names[TUNING_CACHE_LEVELS] = {_SC_LEVEL1_DCACHE_SIZE, _SC_LEVEL2_CACHE_SIZE, _SC_LEVEL3_CACHE_SIZE};
+    for (int level = 0; level < TUNING_CACHE_LEVELS; level++)
+    {
+        sizes[level] = std::max(0L, sysconf(names[level]));
+    }
+#endif
+    return sizes;
+}
+
+/**
+ * @brief constructor
+ */
+TuningTable::TuningTable() : _hostThreads(hostThreads()), _cacheSizes(hostCacheSizes())
+{}
+
+/**
+ * @brief load
+ */
+bool TuningTable::load(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    std::string key, cacheKey;
+    unsigned int threads = 0;
+    std::array<long, TUNING_CACHE_LEVELS> cacheSizes;
+    if (!(file >> key >> threads >> cacheKey) || (key != TUNING_HOST_KEY) || (threads != _hostThreads) ||
+        (cacheKey != TUNING_CACHE_KEY))
+    {
+        return false;
+    }
+    for (long& size : cacheSizes)
+    {
+        if (!(file >> size))
+        {
+            return false;
+        }
+    }
+    if (cacheSizes != _cacheSizes)
+    {
+        return false;
+    }
+    std::map<std::tuple<int, int, int>, KernelConfig> configs;
+    int rows, cols, batch;
+    KernelConfig config;
+    while (file >> rows >> cols >> batch >> config.panelRows >> config.colBlock >> config.threads)
+    {
+        configs[std::make_tuple(rows, cols, batch)] = config;
+    }
+    if (!file.eof())
+    {
+        return false;
+    }
+    _configs.swap(configs);
+    return true;
+}
+
+/**
+ * @brief save
+ */
+bool TuningTable::save(const std::string& path) const
+{
+    std::ofstream file(path);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    file << TUNING_HOST_KEY << " " << _hostThreads << " " << TUNING_CACHE_KEY;
+    for (long size : _cacheSizes)
+    {
+        file << " " << size;
+    }
+    file << std::endl;
+    for (const auto& entry : _configs)
+    {
+        file << std::get<0>(entry.first) << " " << std::get<1>(entry.first) << " " << std::get<2>(entry.first) << " "
+             << entry.second.panelRows << " " << entry.second.colBlock << " " << entry.second.threads << std::endl;
+    }
+    return file.good();
+}
+
+/**
+ * @brief find
+ */
+bool TuningTable::find(const int rows, const int cols, const int batch, KernelConfig& config) const
+{
+    auto found = _configs.find(std::make_tuple(rows, cols, batch));
+    if (found == _configs.end())
+    {
+        return false;
+    }
+    config = found->second;
+    return true;
+}
+
+/**
+ * @brief set
+ */
+void TuningTable::set(const int rows, const int cols, const int batch, const KernelConfig& config)
+{
+    _configs[std::make_tuple(rows, cols, batch)] = config;
+}
+
+/**
+ * @brief tune one layer shape
+ */
+KernelConfig tuneLayer(const Dense& layer, const int batch, const int panelRows)
+{
+    Dense candidate = layer;
+    int cols = layer.getWeights().getCols();
+    Matrix input(cols, batch);
+    for (int index = 0; index < matrixSize(input); index++)
+    {
+        input[index] = (float)(index % 7) / 7; // any fixed data, only the timing matters
+    }
+
+    // heights above the rows of the layer are clamped to them, so several candidates may be the same packing
+    int rows = layer.getWeights().getRows();
+    std::vector<int> panels;
+    if (panelRows > 0)
+    {
+        panels.push_back(std::min(panelRows, rows));
+    }
+    else
+    {
+        for (int panel : panelCandidates)
+        {
+            panel = std::min(panel, rows);
+            if (std::find(panels.begin(), panels.end(), panel) == panels.end())
+            {
+                panels.push_back(panel);
+            }
+        }
+    }
+    std::vector<int> threadCandidates;
+    for (unsigned int threads = 1; threads <= hostThreads(); threads *= 2)
+    {
+        threadCandidates.push_back((int)threads);
+    }
+
+    KernelConfig best = {layer.getPanelRows(), cols, 1};
+    double bestTime = std::numeric_limits<double>::max();
+    for (int panel : panels)
+    {
+        for (int colBlock : colBlockCandidates)
+        {
+            if (colBlock >= cols)
+            {
+                continue; // same as no blocking
+            }
+            for (int threads : threadCandidates)
+            {
+                KernelConfig config = {panel, (colBlock == 0) ? cols : colBlock, threads};
+                candidate.setKernelConfig(batch, config);
+                double fastest = std::numeric_limits<double>::max();
+                for (int repeat = 0; repeat < TUNING_REPEATS; repeat++)
+                {
+                    auto start = std::chrono::steady_clock::now();
+                    candidate(input);
+                    std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+                    fastest = std::min(fastest, time.count());
+                }
+                if (fastest < bestTime)
+                {
+                    bestTime = fastest;
+                    best = config;
+                }
+            }
+        }
+    }
+    return best;
+}
@@ -0,0 +1,90 @@
+/**
+ * @file Autotuner.h
+ * @author  Jonathan Birnbaum
+ * @date 08/06/2020
+ *
+ * @brief kernel autotuning declaration and documentation
+ */
+
+#ifndef AUTOTUNER_H
+#define AUTOTUNER_H
+
+#include <array>
+#include <map>
+#include <string>
+#include <tuple>
+#include "Dense.h"
+
+/**
+ * @brief number of timed runs per candidate (the fastest one counts)
+ */
+#define TUNING_REPEATS (5)
+
+/**
+ * @brief cache levels in the tuning file key (L1 data, L2, L3)
+ */
+#define TUNING_CACHE_LEVELS (3)
+
+/**
+ * @brief tuned kernel configurations per layer shape and batch size, persisted in a small text file keyed by the
+ * host's thread count and cache sizes
+ */
+class TuningTable
+{
+private:
+    unsigned int _hostThreads;
+    std::array<long, TUNING_CACHE_LEVELS> _cacheSizes; // bytes of each cache level
+    std::map<std::tuple<int, int, int>, KernelConfig> _configs; // ((rows, cols, batch), config)
+
+public:
+
+    /**
+     * @brief constructor - empty table for this host
+     */
+    TuningTable();
+
+    /**
+     * @brief load a tuning file
+     * @param path: tuning file path
+     * @return true for success, false if missing, invalid or tuned on a host with another core count or other
+     * cache sizes
+     */
+    bool load(const std::string& path);
+
+    /**
+     * @brief save the table
+     * @param path: tuning file path
+     * @return true for success
+     */
+    bool save(const std::string& path) const;
+
+    /**
+     * @brief find the tuned config of a shape
+     * @param rows: layer output size
+     * @param cols: layer input size
+     * @param batch: batch size
+     * @param config: filled if found
+     * @return true if found
+     */
+    bool find(int rows, int cols, int batch, KernelConfig& config) const;
+
+    /**
+     * @brief set the tuned config of a shape
+     * @param rows: layer output size
+     * @param cols: layer input size
+     * @param batch: batch size
+     * @param config: tuned config
+     */
+    void set(int rows, int cols, int batch, const KernelConfig& config);
+};
+
+/**
+ * @brief time every candidate kernel configuration of a layer on a batch size and pick the fastest
+ * @param layer: layer to tune (not changed)
+ * @param batch: batch size
+ * @param panelRows: panel height to keep, 0 to tune it too
+ * @return fastest config
+ */
+KernelConfig tuneLayer(const Dense& layer, int batch, int panelRows);
+
+#endif //AUTOTUNER_H
@@ -7,19 +7,347 @@
  */
 
 #include "Dense.h"
+#include "KernelPool.h"
+#include "MatrixHash.h"
+#include <algorithm>
+#include <cstdint>
+
+using std::endl;
+using std::cerr;
+
+/**
+ * @brief Exit code for error
+ */
+#define EXIT_ERROR (1)
+
+/**
+ * @brief error massage
+ */
+#define ERROR_MSG_INPUT_SIZE "Error: Input size doesn't match the layer weights"
+
+/**
+ * @brief header of a packed weights block: rows, cols, panel rows, then a 64 bit checksum of the source weights
+ */
+#define PACKED_HEADER_SIZE (3)
+
+/**
+ * @brief odd multiplier combining the weights and bias hashes of the checksum
+ */
+#define PACKED_CHECKSUM_MUL (0x9E3779B97F4A7C15ULL)
+
+/**
+ * @brief checksum of the weights and bias a packing was made from
+ * @param w: weights
+ * @param bias: bias
+ * @return 64 bit checksum
+ */
+static uint64_t parametersChecksum(const Matrix& w, const Matrix& bias)
+{
+    return (hashMatrix(w) * PACKED_CHECKSUM_MUL) ^ hashMatrix(bias);
+}
 
 /**
  * @brief constructor
  */
-Dense::Dense(const Matrix& w, const Matrix& bias, const ActivationType& actType) : _w(w), _bias(bias), _actType(actType)
-{}
+Dense::Dense(const Matrix& w, const Matrix& bias, const ActivationType& actType) : _w(w), _bias(bias),
+                                                                                   _actType(actType), _panelRows(0)
+{
+    packWeights(PANEL_ROWS_DEFAULT);
+}
+
+/**
+ * @brief repack weights into row panels (last panel padded with zeros)
+ */
+void Dense::packWeights(int panelRows)
+{
+    int rows = _w.getRows();
+    int cols = _w.getCols();
+    // a panel taller than the layer only holds padding, and readPacked rejects it
+    panelRows = std::max(1, std::min(panelRows, rows));
+    int numPanels = (rows + panelRows - 1) / panelRows;
+    const float* weights = _w.getData();
+
+    _panelRows = panelRows;
+    _packedW.assign((size_t)numPanels * panelRows * cols, 0);
+    size_t packedIndex = 0;
+    for (int panel = 0; panel < numPanels; panel++)
+    {
+        for (int col = 0; col < cols; col++)
+        {
+            for (int panelRow = 0; panelRow < panelRows; panelRow++, packedIndex++)
+            {
+                int row = (panel * panelRows) + panelRow;
+                if (row < rows)
+                {
+                    _packedW[packedIndex] = weights[(row * cols) + col];
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief set parameters
+ */
+void Dense::setParameters(const Matrix& w, const Matrix& bias)
+{
+    if ((w.getRows() != _w.getRows()) || (w.getCols() != _w.getCols()) || (bias.getRows() != _bias.getRows()))
+    {
+        cerr << ERROR_MSG_INPUT_SIZE << endl;
+        exit(EXIT_ERROR);
+    }
+    _w = w;
+    _bias = bias;
+    packWeights(_panelRows);
+}
+
+/**
+ * @brief transposed packed panel kernel: out += W^T * grad, reading the packed W sequentially as the forward
+ * kernel does, without a transposed copy of W. Every output sums its products in ascending row order.
+ * @param packed: row-panel packed weights
+ * @param panelRows: rows per panel
+ * @param rows: rows of W (= rows of grad)
+ * @param cols: cols of W (= rows of out)
+ * @param grad: gradient values, row-major rows x batch
+ * @param batch: number of gradient columns
+ * @param out: output values, row-major cols x batch
+ */
+static void panelKernelTransposed(const float* packed, const int panelRows, const int rows, const int cols,
+                                  const float* grad, const int batch, float* out)
+{
+    int numPanels = (rows + panelRows - 1) / panelRows;
+    for (int p = 0; p < numPanels; p++)
+    {
+        const float* weightCol = packed + ((size_t)p * panelRows * cols);
+        int panelEnd = std::min(panelRows, rows - (p * panelRows));
+        for (int col = 0; col < cols; col++, weightCol += panelRows)
+        {
+            float* outRow = out + ((size_t)col * batch);
+            for (int panelRow = 0; panelRow < panelEnd; panelRow++)
+            {
+                float weight = weightCol[panelRow];
+                const float* gradRow = grad + ((size_t)((p * panelRows) + panelRow) * batch);
+                for (int b = 0; b < batch; b++)
+                {
+                    outRow[b] += weight * gradRow[b];
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief backward pass - the weight gradient is a product of two row-major matrices by the batch, left to Matrix,
+ * and the input gradient runs on the packed weights
+ */
+Matrix Dense::backward(const Matrix& mat_input, const Matrix& mat_grad, Matrix& grad_w, Matrix& grad_bias) const
+{
+    grad_w = mat_grad * mat_input.transpose();
+    grad_bias = Matrix(mat_grad.getRows(), 1);
+    const float* grad = mat_grad.getData();
+    for (int row = 0; row < mat_grad.getRows(); row++)
+    {
+        float sum = 0;
+        for (int col = 0; col < mat_grad.getCols(); col++)
+        {
+            sum += grad[(row * mat_grad.getCols()) + col];
+        }
+        grad_bias[row] = sum;
+    }
+    Matrix grad_input(_w.getCols(), mat_grad.getCols());
+    panelKernelTransposed(_packedW.data(), _panelRows, _w.getRows(), _w.getCols(), grad, mat_grad.getCols(),
+                          grad_input.getData());
+    return grad_input;
+}
+
+/**
+ * @brief write packed weights
+ */
+bool Dense::writePacked(std::ostream& file) const
+{
+    int header[PACKED_HEADER_SIZE] = {_w.getRows(), _w.getCols(), _panelRows};
+    uint64_t checksum = parametersChecksum(_w, _bias);
+    file.write((const char*) header, sizeof(header));
+    file.write((const char*) &checksum, sizeof(checksum));
+    file.write((const char*) _packedW.data(), _packedW.size() * sizeof(float));
+    return file.good();
+}
+
+/**
+ * @brief read packed weights
+ */
+bool Dense::readPacked(std::istream& file)
+{
+    int header[PACKED_HEADER_SIZE];
+    uint64_t checksum;
+    file.read((char*) header, sizeof(header));
+    file.read((char*) &checksum, sizeof(checksum));
+    // packed from other weights of the same shape would load fine and classify wrong
+    if (!file.good() || (header[0] != _w.getRows()) || (header[1] != _w.getCols()) || (header[2] <= 0) ||
+        (header[2] > header[0]) || (checksum != parametersChecksum(_w, _bias)))
+    {
+        return false;
+    }
+    int numPanels = (header[0] + header[2] - 1) / header[2];
+    std::vector<float> packed((size_t)numPanels * header[2] * header[1]);
+    file.read((char*) packed.data(), packed.size() * sizeof(float));
+    if (!file.good())
+    {
+        return false;
+    }
+    _packedW.swap(packed);
+    _panelRows = header[2];
+    for (auto& config : _configs)
+    {
+        config.second.panelRows = _panelRows;
+    }
+    return true;
+}
+
+/**
+ * @brief packed panel kernel over a range of panels: out = W * input + bias, reading W and input sequentially.
+ * Every output sums its products in column order, then adds the bias, whatever the column blocking.
+ * @param packed: row-panel packed weights
+ * @param panelRows: rows per panel
+ * @param colBlock: columns of W (rows of input) handled per pass, so a block of input stays in cache
+ * @param rows: rows of W
+ * @param cols: cols of W (= rows of input)
+ * @param input: input values, row-major cols x batch
+ * @param batch: number of input columns
+ * @param bias: rows bias values
+ * @param firstPanel: first panel to compute
+ * @param lastPanel: one past the last panel to compute
+ * @param out: output values, row-major rows x batch
+ */
+static void panelKernel(const float* packed, const int panelRows, const int colBlock, const int rows, const int cols,
+                        const float* input, const int batch, const float* bias, const int firstPanel,
+                        const int lastPanel, float* out)
+{
+    // one accumulator per output of the range, kept across the column blocks
+    size_t panelSize = (size_t)panelRows * batch;
+    std::vector<float> acc(panelSize * (lastPanel - firstPanel), 0.0f);
+    for (int colStart = 0; colStart < cols; colStart += colBlock)
+    {
+        int colEnd = std::min(cols, colStart + colBlock);
+        for (int p = firstPanel; p < lastPanel; p++)
+        {
+            float* panelAcc = &acc[panelSize * (p - firstPanel)];
+            const float* weightCol = packed + ((size_t)p * panelRows * cols) + ((size_t)colStart * panelRows);
+            if (batch == 1)
+            {
+                for (int col = colStart; col < colEnd; col++, weightCol += panelRows)
+                {
+                    float value = input[col];
+                    for (int panelRow = 0; panelRow < panelRows; panelRow++)
+                    {
+                        panelAcc[panelRow] += weightCol[panelRow] * value;
+                    }
+                }
+            }
+            else
+            {
+                for (int col = colStart; col < colEnd; col++, weightCol += panelRows)
+                {
+                    const float* inputRow = input + ((size_t)col * batch);
+                    for (int panelRow = 0; panelRow < panelRows; panelRow++)
+                    {
+                        float weight = weightCol[panelRow];
+                        float* accRow = panelAcc + ((size_t)panelRow * batch);
+                        for (int b = 0; b < batch; b++)
+                        {
+                            accRow[b] += weight * inputRow[b];
+                        }
+                    }
+                }
+            }
+        }
+    }
+    for (int p = firstPanel; p < lastPanel; p++)
+    {
+        const float* panelAcc = &acc[panelSize * (p - firstPanel)];
+        for (int panelRow = 0; panelRow < panelRows; panelRow++)
+        {
+            int row = (p * panelRows) + panelRow;
+            if (row >= rows)
+            {
+                break;
+            }
+            for (int b = 0; b < batch; b++)
+            {
+                out[((size_t)row * batch) + b] = panelAcc[((size_t)panelRow * batch) + b] + bias[row];
+            }
+        }
+    }
+}
+
+/**
+ * @brief kernel configuration getter
+ */
+KernelConfig Dense::getKernelConfig(const int batch) const
+{
+    KernelConfig config = {_panelRows, _w.getCols(), 1};
+    auto tuned = _configs.upper_bound(batch);
+    if (tuned != _configs.begin())
+    {
+        config = (--tuned)->second;
+        config.panelRows = _panelRows;
+    }
+    return config;
+}
+
+/**
+ * @brief kernel configuration setter
+ */
+void Dense::setKernelConfig(const int batch, const KernelConfig& config)
+{
+    int panelRows = std::min(config.panelRows, _w.getRows());
+    if ((panelRows > 0) && (panelRows != _panelRows))
+    {
+        packWeights(panelRows);
+    }
+    KernelConfig stored = config;
+    stored.panelRows = _panelRows;
+    stored.colBlock = std::max(1, config.colBlock);
+    stored.threads = std::max(1, config.threads);
+    _configs[batch] = stored;
+}
 
 /**
  * @brief operator ()
  */
 Matrix Dense::operator()(Matrix &mat_input)
 {
-    Matrix mat_layer = ((_w * mat_input) + _bias);
+    if (mat_input.getRows() != _w.getCols())
+    {
+        cerr << ERROR_MSG_INPUT_SIZE << endl;
+        exit(EXIT_ERROR);
+    }
+    int rows = _w.getRows();
+    int batch = mat_input.getCols();
+    Matrix mat_layer(rows, batch);
+    float* out = mat_layer.getData();
+    const float* input = mat_input.getData();
+    const float* bias = _bias.getData();
+
+    KernelConfig config = getKernelConfig(batch);
+    int numPanels = (rows + _panelRows - 1) / _panelRows;
+    int threads = std::min(config.threads, numPanels);
+    if (threads <= 1)
+    {
+        panelKernel(_packedW.data(), _panelRows, config.colBlock, rows, _w.getCols(), input, batch, bias, 0,
+                    numPanels, out);
+    }
+    else
+    {
+        // each thread owns a contiguous range of panels, so output rows are never shared
+        KernelPool::instance().parallelFor(threads, [&](int t)
+        {
+            int firstPanel = (numPanels * t) / threads;
+            int lastPanel = (numPanels * (t + 1)) / threads;
+            panelKernel(_packedW.data(), _panelRows, config.colBlock, rows, _w.getCols(), input, batch, bias,
+                        firstPanel, lastPanel, out);
+        });
+    }
     Activation activator (_actType);
     return activator(mat_layer);
 }
@@ -9,9 +9,26 @@
 #ifndef EX4_DENSE_H
 #define EX4_DENSE_H
 
+#include <map>
+#include <vector>
+#include <iostream>
 #include "Matrix.h"
 #include "Activation.h"
 
+/**
+ * @brief default number of weight rows interleaved in one packed panel (one AVX register of floats)
+ */
+#define PANEL_ROWS_DEFAULT (8)
+
+/**
+ * @struct KernelConfig
+ * @brief how the packed kernel runs: panel height, columns per cache block, threads splitting the panels
+ */
+typedef struct KernelConfig
+{
+    int panelRows, colBlock, threads;
+} KernelConfig;
+
 /**
  * @brief Dense class - representing a layer in the net
  */
@@ -21,6 +38,15 @@ private:
     Matrix _w;
     Matrix _bias;
     ActivationType _actType;
+    std::vector<float> _packedW; // _w in row panels: for each panel, for each column, panelRows weights
+    int _panelRows;
+    std::map<int, KernelConfig> _configs; // (smallest batch, kernel config), tuned per batch size
+
+    /**
+     * @brief repack _w into row panels of the given height
+     * @param panelRows: number of rows interleaved in each panel, at most the rows of _w
+     */
+    void packWeights(int panelRows);
 
 public:
 
@@ -50,9 +76,62 @@ public:
      */
     Activation getActivation() const {return Activation (_actType); }
 
+    /**
+     * @brief Getter - height of the packed weight panels
+     * @return rows per panel
+     */
+    int getPanelRows() const {return _panelRows; }
+
+    /**
+     * @brief Getter - kernel configuration used for a batch size
+     * @param batch: number of input columns
+     * @return config of the largest tuned batch not above it (untuned: one thread, no column blocking)
+     */
+    KernelConfig getKernelConfig(int batch) const;
+
+    /**
+     * @brief use a kernel configuration from this batch size up (repacks if the panel height changes, a height
+     * above the rows of the layer is clamped to them)
+     * @param batch: smallest number of input columns to use it for
+     * @param config: kernel configuration
+     */
+    void setKernelConfig(int batch, const KernelConfig& config);
+
+    /**
+     * @brief replace the weights and bias (same sizes) and repack
+     * @param w: new weights
+     * @param bias: new bias
+     */
+    void setParameters(const Matrix& w, const Matrix& bias);
+
+    /**
+     * @brief backward pass of the affine part of the layer
+     * @param mat_input: input of the forward pass
+     * @param mat_grad: gradient of the loss by the layer output before activation
+     * @param grad_w: filled with the gradient by the weights
+     * @param grad_bias: filled with the gradient by the bias
+     * @return gradient of the loss by the input
+     */
+    Matrix backward(const Matrix& mat_input, const Matrix& mat_grad, Matrix& grad_w, Matrix& grad_bias) const;
+
+    /**
+     * @brief write the packed weights (header + panels) to a binary stream
+     * @param file: stream to write to
+     * @return true for success
+     */
+    bool writePacked(std::ostream& file) const;
+
+    /**
+     * @brief read packed weights written by writePacked instead of repacking
+     * @param file: stream to read from
+     * @return true for success, false (packing unchanged) if the data doesn't fit this layer or was packed from
+     * other weights
+     */
+    bool readPacked(std::istream& file);
+
     /**
      * @brief operator ()
-     * @param mat_input: input matrix
+     * @param mat_input: input matrix (one input vector per column)
      * @return new matrix after layer activation
      */
     Matrix operator() (Matrix& mat_input);
@@ -0,0 +1,73 @@
+/**
+ * @file HashBenchmark.cpp
+ * @author  Jonathan Birnbaum
+ * @date 08/06/2020
+ *
+ * @brief benchmark of the inference cache key: hashing an image against classifying it
+ */
+
+#include "MatrixHash.h"
+#include "MlpNetwork.h"
+#include "Trainer.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+
+#define BENCHMARK_ITERATIONS (2000)
+#define BENCHMARK_SEED (1)
+
+
+/**
+ * @brief random vectorized image in the network input size
+ * @param generator: random generator
+ * @return 784x1 input matrix
+ */
+static Matrix randomImage(std::mt19937& generator)
+{
+    std::uniform_real_distribution<float> pixel(0, 1);
+    Matrix image(imgDims.rows, imgDims.cols);
+    for (int index = 0; index < imgDims.rows * imgDims.cols; index++)
+    {
+        image[index] = pixel(generator);
+    }
+    return image.vectorize();
+}
+
+
+/**
+ * @brief average time of a function over BENCHMARK_ITERATIONS calls
+ * @param run: function to time, returning a value that is kept so the call isn't optimized away
+ * @return nanoseconds per call
+ */
+template <class Run>
+static double timeCalls(Run run)
+{
+    volatile uint64_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int iteration = 0; iteration < BENCHMARK_ITERATIONS; iteration++)
+    {
+        sink = sink + (uint64_t)run();
+    }
+    std::chrono::duration<double, std::nano> time = std::chrono::steady_clock::now() - start;
+    return time.count() / BENCHMARK_ITERATIONS;
+}
+
+
+int main()
+{
+    Matrix weights[MLP_SIZE];
+    Matrix biases[MLP_SIZE];
+    initWeights(weights, biases, BENCHMARK_SEED);
+    MlpNetwork network(weights, biases); // no cache: every call is a full forward pass
+
+    std::mt19937 generator(BENCHMARK_SEED);
+    Matrix input = randomImage(generator);
+    double hashTime = timeCalls([&]() { return hashMatrix(input); });
+    double forwardTime = timeCalls([&]() { return network(input).value; });
+
+    printf("%8s %12s %12s %10s\n", "input", "hash[ns]", "forward[ns]", "overhead");
+    printf("%8d %12.1f %12.1f %9.2f%%\n", input.getRows() * input.getCols(), hashTime, forwardTime,
+           100 * hashTime / forwardTime);
+    return 0;
+}
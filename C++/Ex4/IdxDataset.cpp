@@ -0,0 +1,204 @@
+/**
+ * @file IdxDataset.cpp
+ * @author  Jonathan Birnbaum
+ * @date 08/06/2020
+ *
+ * @brief IDX (MNIST) dataset reader and bulk evaluation implementation
+ */
+
+#include "IdxDataset.h"
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using std::endl;
+using std::cerr;
+
+/**
+ * @brief IDX magic: two zero bytes, data type, number of dimensions
+ */
+#define IDX_TYPE_UBYTE (0x08)
+#define IDX_HEADER_MAGIC_SIZE (4)
+#define IDX_DIM_SIZE (4)
+
+/**
+ * @brief pixel scale to [0, 1]
+ */
+#define PIXEL_MAX_VALUE (255.0f)
+
+/**
+ * @brief error massages
+ */
+#define ERROR_MSG_OPEN_IDX "Error: Unable to map IDX file "
+#define ERROR_MSG_IDX_HEADER "Error: Invalid IDX header in "
+#define ERROR_MSG_DATASET_MISMATCH "Error: Images and labels count don't match"
+#define ERROR_MSG_BATCH_SIZE "Error: Batch size must be positive"
+
+/**
+ * @brief read a big-endian 32 bit integer
+ * @param bytes: 4 bytes
+ * @return value
+ */
+static int readBigEndian(const unsigned char* bytes)
+{
+    return (int)(((unsigned int)bytes[0] << 24) | ((unsigned int)bytes[1] << 16) | ((unsigned int)bytes[2] << 8) |
+                 (unsigned int)bytes[3]);
+}
+
+/**
+ * @brief default constructor
+ */
+IdxFile::IdxFile() : _mapped(nullptr), _mappedSize(0), _data(nullptr), _count(0), _itemSize(0), _dims{1, 1}
+{}
+
+/**
+ * @brief destructor
+ */
+IdxFile::~IdxFile()
+{
+    if (_mapped != nullptr)
+    {
+        munmap(_mapped, _mappedSize);
+    }
+}
+
+/**
+ * @brief map the file and check the header
+ */
+bool IdxFile::open(const std::string& path, const int expectedDims)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        cerr << ERROR_MSG_OPEN_IDX << path << endl;
+        return false;
+    }
+    struct stat fileStat{};
+    if ((fstat(fd, &fileStat) != 0) || (fileStat.st_size == 0))
+    {
+        close(fd);
+        cerr << ERROR_MSG_OPEN_IDX << path << endl;
+        return false;
+    }
+    size_t size = (size_t)fileStat.st_size;
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED)
+    {
+        cerr << ERROR_MSG_OPEN_IDX << path << endl;
+        return false;
+    }
+    madvise(mapped, size, MADV_SEQUENTIAL);
+
+    const unsigned char* bytes = (const unsigned char*) mapped;
+    size_t headerSize = IDX_HEADER_MAGIC_SIZE + ((size_t)expectedDims * IDX_DIM_SIZE);
+    bool valid = (size >= headerSize) && (bytes[0] == 0) && (bytes[1] == 0) && (bytes[2] == IDX_TYPE_UBYTE) &&
+                 (bytes[3] == expectedDims);
+    int dims[3] = {0, 1, 1};
+    size_t itemSize = 1;
+    for (int i = 0; valid && (i < expectedDims); i++)
+    {
+        dims[i] = readBigEndian(bytes + IDX_HEADER_MAGIC_SIZE + (i * IDX_DIM_SIZE));
+        valid = (dims[i] > 0);
+        itemSize *= (i > 0) ? (size_t)dims[i] : 1;
+    }
+    if (!valid || (size < headerSize + ((size_t)dims[0] * itemSize)))
+    {
+        munmap(mapped, size);
+        cerr << ERROR_MSG_IDX_HEADER << path << endl;
+        return false;
+    }
+
+    if (_mapped != nullptr)
+    {
+        munmap(_mapped, _mappedSize);
+    }
+    _mapped = (unsigned char*) mapped;
+    _mappedSize = size;
+    _data = bytes + headerSize;
+    _count = dims[0];
+    _itemSize = (int)itemSize;
+    _dims[0] = dims[1];
+    _dims[1] = dims[2];
+    return true;
+}
+
+/**
+ * @brief decode one image
+ */
+void IdxImages::toMatrix(const int i, Matrix& out) const
+{
+    const unsigned char* pixels = item(i);
+    float* values = out.getData();
+    for (int index = 0; index < getItemSize(); index++)
+    {
+        values[index] = pixels[index] / PIXEL_MAX_VALUE;
+    }
+}
+
+/**
+ * @brief decode a batch of images, one per column
+ */
+void IdxImages::toBatch(const int first, Matrix& out) const
+{
+    int batch = out.getCols();
+    float* values = out.getData();
+    for (int b = 0; b < batch; b++)
+    {
+        const unsigned char* pixels = item(first + b);
+        for (int index = 0; index < getItemSize(); index++)
+        {
+            values[((size_t)index * batch) + b] = pixels[index] / PIXEL_MAX_VALUE;
+        }
+    }
+}
+
+/**
+ * @brief evaluate a whole dataset
+ */
+EvaluationResult evaluateDataset(MlpNetwork& network, const IdxImages& images, const IdxLabels& labels,
+                                 const int batchSize)
+{
+    EvaluationResult result = {0, 0, 0, 0};
+    if (images.getCount() != labels.getCount())
+    {
+        cerr << ERROR_MSG_DATASET_MISMATCH << endl;
+        return result;
+    }
+    if (batchSize <= 0)
+    {
+        cerr << ERROR_MSG_BATCH_SIZE << endl;
+        return result;
+    }
+
+    std::vector<Digit> digits(batchSize);
+    Matrix batch(images.getItemSize(), batchSize);
+    auto start = std::chrono::steady_clock::now();
+    for (int first = 0; first < images.getCount(); first += batchSize)
+    {
+        int current = std::min(batchSize, images.getCount() - first);
+        if (current != batch.getCols())
+        {
+            batch = Matrix(images.getItemSize(), current); // only the last, smaller batch
+        }
+        images.toBatch(first, batch);
+        network.classifyBatch(batch, digits.data());
+        for (int b = 0; b < current; b++)
+        {
+            result.correct += (digits[b].value == labels.label(first + b)) ? 1 : 0;
+        }
+        result.total += current;
+    }
+    std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+
+    if (result.total > 0)
+    {
+        result.accuracy = (double)result.correct / result.total;
+        result.imagesPerSecond = (seconds.count() > 0) ? (result.total / seconds.count()) : 0;
+    }
+    return result;
+}
@@ -0,0 +1,158 @@
+/**
+ * @file IdxDataset.h
+ * @author  Jonathan Birnbaum
+ * @date 08/06/2020
+ *
+ * @brief IDX (MNIST) dataset reader and bulk evaluation declaration and documentation
+ */
+
+#ifndef IDXDATASET_H
+#define IDXDATASET_H
+
+#include <string>
+#include <cstddef>
+#include "Matrix.h"
+#include "MlpNetwork.h"
+
+/**
+ * @brief default number of images classified together by evaluateDataset
+ */
+#define EVAL_BATCH_DEFAULT (64)
+
+/**
+ * @brief read-only memory mapping of an IDX file (big-endian header, unsigned byte data)
+ */
+class IdxFile
+{
+private:
+    unsigned char* _mapped;
+    size_t _mappedSize;
+    const unsigned char* _data;
+    int _count;
+    int _itemSize;
+    int _dims[2];
+
+public:
+
+    /**
+     * @brief default constructor - empty file
+     */
+    IdxFile();
+
+    IdxFile(const IdxFile&) = delete;
+    IdxFile& operator=(const IdxFile&) = delete;
+
+    /**
+     * @brief destructor - unmaps the file
+     */
+    ~IdxFile();
+
+    /**
+     * @brief map an IDX file and check its header
+     * @param path: file path
+     * @param expectedDims: number of dimensions (1 for labels, 3 for images)
+     * @return true for success
+     */
+    bool open(const std::string& path, int expectedDims);
+
+    /**
+     * @brief getter number of items
+     * @return first dimension of the file
+     */
+    int getCount() const {return _count; }
+
+    /**
+     * @brief getter item size
+     * @return bytes per item (product of the other dimensions)
+     */
+    int getItemSize() const {return _itemSize; }
+
+    /**
+     * @brief getter a dimension of an item
+     * @param i: 0 for rows, 1 for cols
+     * @return dimension value (1 for labels)
+     */
+    int getDim(int i) const {return _dims[i]; }
+
+    /**
+     * @brief zero-copy access to one item
+     * @param i: item index
+     * @return pointer into the mapped file
+     */
+    const unsigned char* item(int i) const {return _data + ((size_t)i * _itemSize); }
+};
+
+/**
+ * @brief images file (IDX3, 28x28 unsigned byte pixels)
+ */
+class IdxImages : public IdxFile
+{
+public:
+
+    /**
+     * @brief map an images file
+     * @param path: file path
+     * @return true for success
+     */
+    bool open(const std::string& path) {return IdxFile::open(path, 3); }
+
+    /**
+     * @brief decode one image into a vectorized matrix, pixels scaled to [0, 1]
+     * @param i: image index
+     * @param out: matrix of getItemSize() x 1 to fill
+     */
+    void toMatrix(int i, Matrix& out) const;
+
+    /**
+     * @brief decode consecutive images into the columns of a batch matrix
+     * @param first: first image index
+     * @param out: matrix of getItemSize() x batch to fill, one image per column
+     */
+    void toBatch(int first, Matrix& out) const;
+};
+
+/**
+ * @brief labels file (IDX1, unsigned byte digit per item)
+ */
+class IdxLabels : public IdxFile
+{
+public:
+
+    /**
+     * @brief map a labels file
+     * @param path: file path
+     * @return true for success
+     */
+    bool open(const std::string& path) {return IdxFile::open(path, 1); }
+
+    /**
+     * @brief getter label
+     * @param i: label index
+     * @return the digit
+     */
+    unsigned int label(int i) const {return *item(i); }
+};
+
+/**
+ * @struct EvaluationResult
+ * @brief summary of a bulk evaluation
+ */
+typedef struct EvaluationResult
+{
+    int total, correct;
+    double accuracy, imagesPerSecond;
+} EvaluationResult;
+
+/**
+ * @brief classify every image of a dataset in batches and compare with its label
+ * @param network: network to evaluate
+ * @param images: mapped images
+ * @param labels: mapped labels (same count as images)
+ * @param batchSize: images per batch, at least 1
+ * @return accuracy and throughput over the whole set, all zero (nothing classified) if the images don't match the
+ * labels count or the batch size isn't positive
+ */
+EvaluationResult evaluateDataset(MlpNetwork& network, const IdxImages& images, const IdxLabels& labels,
+                                 int batchSize = EVAL_BATCH_DEFAULT);
+
+#endif //IDXDATASET_H
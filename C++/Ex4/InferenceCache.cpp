@@ -0,0 +1,92 @@
+/**
+ * @file InferenceCache.cpp
+ * @author  Jonathan Birnbaum
+ * @date 08/06/2020
+ *
+ * @brief InferenceCache class implementation
+ */
+
+#include "InferenceCache.h"
+#include <algorithm>
+
+/**
+ * @brief constructor
+ */
+InferenceCache::InferenceCache(const size_t capacity, const int numShards) :
+        _shards(new Shard[numShards > 0 ? numShards : 1]), _numShards(numShards > 0 ? numShards : 1),
+        _shardCapacity(1), _hits(0), _misses(0)
+{
+    _shardCapacity = std::max((size_t)1, capacity / _numShards);
+    for (int i = 0; i < _numShards; i++)
+    {
+        _shards[i].entries.reserve(_shardCapacity);
+        _shards[i].index.reserve(_shardCapacity);
+        _shards[i].hand = 0;
+    }
+}
+
+/**
+ * @brief lookup
+ */
+bool InferenceCache::lookup(const uint64_t key, Digit& digit)
+{
+    Shard& shard = shardOf(key);
+    {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        auto found = shard.index.find(key);
+        if (found != shard.index.end())
+        {
+            Entry& entry = shard.entries[found->second];
+            entry.referenced = true;
+            digit = entry.digit;
+            _hits.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    _misses.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+/**
+ * @brief clear
+ */
+void InferenceCache::clear()
+{
+    for (int i = 0; i < _numShards; i++)
+    {
+        std::lock_guard<std::mutex> guard(_shards[i].lock);
+        _shards[i].entries.clear();
+        _shards[i].index.clear();
+        _shards[i].hand = 0;
+    }
+}
+
+/**
+ * @brief insert
+ */
+void InferenceCache::insert(const uint64_t key, const Digit& digit)
+{
+    Shard& shard = shardOf(key);
+    std::lock_guard<std::mutex> guard(shard.lock);
+    if (shard.index.find(key) != shard.index.end())
+    {
+        return; // another thread computed the same input meanwhile
+    }
+    if (shard.entries.size() < _shardCapacity)
+    {
+        shard.index[key] = shard.entries.size();
+        shard.entries.push_back(Entry{key, digit, false});
+        return;
+    }
+    // CLOCK: advance the hand, giving referenced entries a second chance
+    while (shard.entries[shard.hand].referenced)
+    {
+        shard.entries[shard.hand].referenced = false;
+        shard.hand = (shard.hand + 1) % _shardCapacity;
+    }
+    Entry& victim = shard.entries[shard.hand];
+    shard.index.erase(victim.key);
+    victim = Entry{key, digit, false};
+    shard.index[key] = shard.hand;
+    shard.hand = (shard.hand + 1) % _shardCapacity;
+}
@@ -0,0 +1,108 @@
+/**
+ * @file InferenceCache.h
+ * @author  Jonathan Birnbaum
+ * @date 08/06/2020
+ *
+ * @brief InferenceCache class declaration and documentation
+ */
+
+#ifndef INFERENCECACHE_H
+#define INFERENCECACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "Digit.h"
+
+#define CACHE_CAPACITY_DEFAULT (4096)
+#define CACHE_SHARDS_DEFAULT (16)
+
+/**
+ * @brief bounded cache of classification results keyed by input hash (hashMatrix).
+ * Sharded by key, each shard has its own lock and evicts with the CLOCK (second chance) policy.
+ * Only the 64 bit hash of an input is kept, not the input, so two inputs with the same hash share a result: with
+ * n cached results, a new input collides with probability about n / 2^64 (below 1e-15 at the default capacity)
+ */
+class InferenceCache
+{
+private:
+    /**
+     * @brief one cached result
+     */
+    struct Entry
+    {
+        uint64_t key;
+        Digit digit;
+        bool referenced;
+    };
+
+    /**
+     * @brief independent part of the cache with its own lock
+     */
+    struct Shard
+    {
+        std::mutex lock;
+        std::vector<Entry> entries; // the clock ring
+        std::unordered_map<uint64_t, size_t> index; // (key, position in entries)
+        size_t hand;
+    };
+
+    std::unique_ptr<Shard[]> _shards;
+    int _numShards;
+    size_t _shardCapacity;
+    std::atomic<unsigned long> _hits;
+    std::atomic<unsigned long> _misses;
+
+    /**
+     * @brief shard of a key
+     * @param key: input hash
+     * @return the shard holding this key
+     */
+    Shard& shardOf(uint64_t key) const {return _shards[(key >> 32) % _numShards]; }
+
+public:
+
+    /**
+     * @brief constructor
+     * @param capacity: maximum number of results held (split evenly between shards)
+     * @param numShards: number of independently locked shards
+     */
+    explicit InferenceCache(size_t capacity = CACHE_CAPACITY_DEFAULT, int numShards = CACHE_SHARDS_DEFAULT);
+
+    /**
+     * @brief look a result up, counting a hit or a miss
+     * @param key: input hash
+     * @param digit: filled with the cached result on a hit
+     * @return true on a hit
+     */
+    bool lookup(uint64_t key, Digit& digit);
+
+    /**
+     * @brief drop every result (the hit and miss counters are kept)
+     */
+    void clear();
+
+    /**
+     * @brief insert a result, evicting by CLOCK if the shard is full
+     * @param key: input hash
+     * @param digit: result to keep
+     */
+    void insert(uint64_t key, const Digit& digit);
+
+    /**
+     * @brief getter hits
+     * @return number of lookups that found a result
+     */
+    unsigned long getHits() const {return _hits.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief getter misses
+     * @return number of lookups that didn't find a result
+     */
+    unsigned long getMisses() const {return _misses.load(std::memory_order_relaxed); }
+};
+
+#endif //INFERENCECACHE_H
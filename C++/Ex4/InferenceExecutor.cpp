@@ -0,0 +1,182 @@
+/**
+ * @file InferenceExecutor.cpp
+ * @author  Jonathan Birnbaum
+ * @date 08/06/2020
+ *
+ * @brief InferenceExecutor class implementation
+ */
+
+#include "InferenceExecutor.h"
+#include <memory>
+#include <vector>
+
+/**
+ * @brief constructor
+ */
+InferenceExecutor::InferenceExecutor(const MlpNetwork& network, const int maxBatch) :
+        _network(network), _maxBatch(maxBatch > 0 ? maxBatch : 1), _stopping(false), _resuming(false),
+        _workerDone(false)
+{
+    _worker = std::thread(&InferenceExecutor::run, this);
+}
+
+/**
+ * @brief destructor
+ */
+InferenceExecutor::~InferenceExecutor()
+{
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _stopping = true;
+    }
+    _wakeUp.notify_one();
+    _worker.join();
+    // only the worker starts the continuation thread, so it can't start after this
+    if (_resumer.joinable())
+    {
+        _resumer.join();
+    }
+}
+
+/**
+ * @brief submit with future
+ */
+std::future<Digit> InferenceExecutor::submit(const Matrix& input)
+{
+    std::shared_ptr<std::promise<Digit>> promise = std::make_shared<std::promise<Digit>>();
+    std::future<Digit> result = promise->get_future();
+    submit(input, [promise](const Digit& digit)
+    {
+        promise->set_value(digit);
+    });
+    return result;
+}
+
+/**
+ * @brief submit with callback
+ */
+void InferenceExecutor::submit(const Matrix& input, Callback done)
+{
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _queue.push_back(Request{input, std::move(done)});
+    }
+    _wakeUp.notify_one();
+}
+
+/**
+ * @brief post a continuation
+ */
+void InferenceExecutor::post(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _continuations.push_back(std::move(task));
+        if (!_resumer.joinable())
+        {
+            _resumer = std::thread(&InferenceExecutor::runContinuations, this);
+        }
+    }
+    _resumeWakeUp.notify_one();
+}
+
+/**
+ * @brief continuation loop
+ */
+void InferenceExecutor::runContinuations()
+{
+    std::unique_lock<std::mutex> guard(_lock);
+    while (true)
+    {
+        _resumeWakeUp.wait(guard, [this] {return _workerDone || !_continuations.empty(); });
+        if (_continuations.empty())
+        {
+            return; // the worker is done, nothing can post anymore
+        }
+        std::function<void()> task = std::move(_continuations.front());
+        _continuations.pop_front();
+        _resuming = true;
+        guard.unlock();
+        try
+        {
+            task();
+        }
+        catch (...)
+        {
+            // a throwing continuation must not stop the ones after it
+        }
+        guard.lock();
+        _resuming = false;
+        _wakeUp.notify_one(); // the worker may be waiting for this continuation to finish
+    }
+}
+
+/**
+ * @brief worker loop
+ */
+void InferenceExecutor::run()
+{
+    std::vector<Request> batch;
+    std::vector<Digit> results;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> guard(_lock);
+            _wakeUp.wait(guard, [this]
+            {
+                return !_queue.empty() || (_stopping && _continuations.empty() && !_resuming);
+            });
+            if (_queue.empty())
+            {
+                // stopping and drained
+                _workerDone = true;
+                _resumeWakeUp.notify_one();
+                return;
+            }
+            // take whatever queued up meanwhile - the busier the callers, the bigger the batch
+            batch.push_back(std::move(_queue.front()));
+            _queue.pop_front();
+            while (!_queue.empty() && ((int)batch.size() < _maxBatch) &&
+                   (matrixSize(_queue.front().input) == matrixSize(batch[0].input)))
+            {
+                batch.push_back(std::move(_queue.front()));
+                _queue.pop_front();
+            }
+        }
+
+        results.resize(batch.size());
+        if (batch.size() == 1)
+        {
+            results[0] = _network(batch[0].input);
+        }
+        else
+        {
+            int size = matrixSize(batch[0].input);
+            int count = (int)batch.size();
+            Matrix inputs(size, count);
+            float* values = inputs.getData();
+            for (int b = 0; b < count; b++)
+            {
+                const float* input = batch[b].input.getData();
+                for (int index = 0; index < size; index++)
+                {
+                    values[((size_t)index * count) + b] = input[index];
+                }
+            }
+            _network.classifyBatch(inputs, results.data());
+        }
+
+        for (size_t b = 0; b < batch.size(); b++)
+        {
+            try
+            {
+                batch[b].done(results[b]);
+            }
+            catch (...)
+            {
+                // a throwing callback must not stop the worker, nor leave the rest of the batch unanswered
+            }
+        }
+        batch.clear();
+    }
+}
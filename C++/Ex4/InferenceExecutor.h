@@ -0,0 +1,150 @@
+/**
+ * @file InferenceExecutor.h
+ * @author  Jonathan Birnbaum
+ * @date 08/06/2020
+ *
+ * @brief InferenceExecutor class declaration and documentation
+ */
+
+#ifndef INFERENCEEXECUTOR_H
+#define INFERENCEEXECUTOR_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include "MlpNetwork.h"
+
+#if (__cplusplus >= 202002L) && defined(__has_include)
+#if __has_include(<coroutine>)
+#include <coroutine>
+#define INFERENCE_HAS_COROUTINES
+#endif
+#endif
+
+/**
+ * @brief default maximum number of queued inputs classified together
+ */
+#define EXECUTOR_BATCH_DEFAULT (32)
+
+/**
+ * @brief asynchronous inference - queued inputs are classified in batches on a worker thread
+ */
+class InferenceExecutor
+{
+public:
+    typedef std::function<void(const Digit&)> Callback;
+
+private:
+    /**
+     * @brief one queued input and where its result goes
+     */
+    struct Request
+    {
+        Matrix input;
+        Callback done;
+    };
+
+    MlpNetwork _network;
+    int _maxBatch;
+    std::deque<Request> _queue;
+    std::deque<std::function<void()>> _continuations; // run on _resumer, off the worker
+    std::mutex _lock;
+    std::condition_variable _wakeUp;
+    std::condition_variable _resumeWakeUp;
+    bool _stopping;
+    bool _resuming; // _resumer is running a continuation, which may submit more requests
+    bool _workerDone;
+    std::thread _worker;
+    std::thread _resumer; // started by the first continuation
+
+    /**
+     * @brief worker loop - takes up to _maxBatch requests at a time until stopped and drained (requests and
+     * continuations, as a continuation may submit again)
+     */
+    void run();
+
+    /**
+     * @brief continuation loop - runs posted continuations in order until the worker is done and they are drained
+     */
+    void runContinuations();
+
+    /**
+     * @brief run a task on the continuation thread, so a slow task doesn't hold up inference
+     * @param task: task to run
+     */
+    void post(std::function<void()> task);
+
+public:
+
+    /**
+     * @brief constructor - starts the worker thread
+     * @param network: network to run (copied, owned by the executor)
+     * @param maxBatch: maximum number of requests per batch
+     */
+    explicit InferenceExecutor(const MlpNetwork& network, int maxBatch = EXECUTOR_BATCH_DEFAULT);
+
+    InferenceExecutor(const InferenceExecutor&) = delete;
+    InferenceExecutor& operator=(const InferenceExecutor&) = delete;
+
+    /**
+     * @brief destructor - finishes every queued request and continuation, then stops the threads
+     */
+    ~InferenceExecutor();
+
+    /**
+     * @brief queue an input
+     * @param input: vectorized image
+     * @return future of the classification
+     */
+    std::future<Digit> submit(const Matrix& input);
+
+    /**
+     * @brief queue an input
+     * @param input: vectorized image
+     * @param done: called on the worker thread with the classification, so it should be short. An exception it throws
+     * is dropped
+     */
+    void submit(const Matrix& input, Callback done);
+
+#ifdef INFERENCE_HAS_COROUTINES
+    /**
+     * @brief awaitable classification: co_await suspends the coroutine and resumes it on the executor's continuation
+     * thread, never on the worker, so the code after co_await doesn't stall the batches behind it
+     */
+    class Awaitable
+    {
+    private:
+        InferenceExecutor& _executor;
+        Matrix _input;
+        Digit _result;
+
+    public:
+        Awaitable(InferenceExecutor& executor, const Matrix& input) : _executor(executor), _input(input), _result{} {}
+
+        bool await_ready() const noexcept {return false; }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            _executor.submit(_input, [this, handle](const Digit& digit)
+            {
+                _result = digit;
+                _executor.post([handle] {handle.resume(); });
+            });
+        }
+
+        Digit await_resume() const noexcept {return _result; }
+    };
+
+    /**
+     * @brief queue an input for co_await
+     * @param input: vectorized image
+     * @return awaitable of the classification
+     */
+    Awaitable classify(const Matrix& input) {return Awaitable(*this, input); }
+#endif
+};
+
+#endif //INFERENCEEXECUTOR_H
@@ -0,0 +1,92 @@
+/**
+ * @file KernelPool.cpp
+ * @author  Jonathan Birnbaum
+ * @date 08/06/2020
+ *
+ * @brief KernelPool class implementation
+ */
+
+#include "KernelPool.h"
+
+/**
+ * @brief destructor
+ */
+KernelPool::~KernelPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _stopping = true;
+    }
+    _wakeUp.notify_all();
+    for (auto& worker : _workers)
+    {
+        worker.join();
+    }
+}
+
+/**
+ * @brief pool instance
+ */
+KernelPool& KernelPool::instance()
+{
+    static KernelPool pool;
+    return pool;
+}
+
+/**
+ * @brief worker loop
+ */
+void KernelPool::run()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> guard(_lock);
+            _wakeUp.wait(guard, [this]() {return _stopping || !_tasks.empty(); });
+            if (_tasks.empty())
+            {
+                return;
+            }
+            task = std::move(_tasks.front());
+            _tasks.pop_front();
+        }
+        task();
+    }
+}
+
+/**
+ * @brief parallel for
+ */
+void KernelPool::parallelFor(const int count, const std::function<void(int)>& body)
+{
+    std::mutex doneLock;
+    std::condition_variable done;
+    int remaining = count - 1;
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        while ((int)_workers.size() < count - 1)
+        {
+            _workers.emplace_back(&KernelPool::run, this);
+        }
+        for (int part = 1; part < count; part++)
+        {
+            _tasks.emplace_back([&body, &doneLock, &done, &remaining, part]()
+            {
+                body(part);
+                std::lock_guard<std::mutex> doneGuard(doneLock);
+                if (--remaining == 0)
+                {
+                    done.notify_one();
+                }
+            });
+        }
+    }
+    _wakeUp.notify_all();
+    if (count > 0)
+    {
+        body(0);
+    }
+    std::unique_lock<std::mutex> doneGuard(doneLock);
+    done.wait(doneGuard, [&remaining]() {return remaining <= 0; });
+}
@@ -0,0 +1,64 @@
+/**
+ * @file KernelPool.h
+ * @author  Jonathan Birnbaum
+ * @date 08/06/2020
+ *
+ * @brief KernelPool class declaration and documentation
+ */
+
+#ifndef KERNELPOOL_H
+#define KERNELPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief persistent worker threads shared by every layer, so a multi threaded kernel call doesn't start threads
+ */
+class KernelPool
+{
+private:
+    std::vector<std::thread> _workers;
+    std::deque<std::function<void()>> _tasks;
+    std::mutex _lock;
+    std::condition_variable _wakeUp;
+    bool _stopping;
+
+    /**
+     * @brief constructor - no workers until the first parallel call needs them
+     */
+    KernelPool() : _stopping(false) {}
+
+    /**
+     * @brief worker loop - runs queued tasks until stopped
+     */
+    void run();
+
+public:
+    KernelPool(const KernelPool&) = delete;
+    KernelPool& operator=(const KernelPool&) = delete;
+
+    /**
+     * @brief destructor - stops and joins the workers
+     */
+    ~KernelPool();
+
+    /**
+     * @brief the process wide pool
+     * @return pool instance
+     */
+    static KernelPool& instance();
+
+    /**
+     * @brief run body(0) .. body(count - 1) in parallel, body(0) on the calling thread, and wait for all of them
+     * @param count: number of parts
+     * @param body: work of one part, must not call parallelFor itself
+     */
+    void parallelFor(int count, const std::function<void(int)>& body);
+};
+
+#endif //KERNELPOOL_H
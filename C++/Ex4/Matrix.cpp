@@ -141,6 +141,22 @@ Matrix& Matrix::vectorize()
     return *this;
 }
 
+/**
+ * @brief transposed copy
+ */
+Matrix Matrix::transpose() const
+{
+    Matrix transposed(_matrixDims.cols, _matrixDims.rows);
+    for (int row = 0; row < _matrixDims.rows; row++)
+    {
+        for (int col = 0; col < _matrixDims.cols; col++)
+        {
+            transposed._matrix[(col * _matrixDims.rows) + row] = _matrix[(row * _matrixDims.cols) + col];
+        }
+    }
+    return transposed;
+}
+
 /**
  * @brief print matrix
  */
@@ -196,17 +212,19 @@ Matrix Matrix::operator*(const Matrix &rhs) const
 
     Matrix multi_mat(_matrixDims.rows, rhs._matrixDims.cols);
 
+    // row-index-col order so rhs is read row by row (sequentially) instead of down its columns,
+    // every element still sums its products in the same index order
     for (int row = 0; row < _matrixDims.rows; row++) // for each row in this matrix
     {
-        for (int col = 0; col < rhs._matrixDims.cols; col++) // for each col in rhs matrix
+        float* multi_row = multi_mat._matrix + (row * rhs._matrixDims.cols);
+        for (int index = 0; index < _matrixDims.cols; index++) // for each element in multiplication
         {
-            float index_sum = 0;
-            for (int index = 0; index < _matrixDims.cols; index++) // for each element in multiplication
+            float left_value = _matrix[(row * _matrixDims.cols) + index];
+            const float* rhs_row = rhs._matrix + (index * rhs._matrixDims.cols);
+            for (int col = 0; col < rhs._matrixDims.cols; col++) // for each col in rhs matrix
             {
-                index_sum += _matrix[(row * _matrixDims.cols) + index] * rhs._matrix[(index * rhs._matrixDims.cols) +
-                                                                                     col];
+                multi_row[col] += left_value * rhs_row[col];
             }
-            multi_mat._matrix[(row * rhs._matrixDims.cols) + col] = index_sum;
         }
     }
     return multi_mat;
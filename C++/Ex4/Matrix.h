@@ -71,6 +71,17 @@ public:
      */
     int getCols() const {return _matrixDims.cols; }
 
+    /**
+     * @brief getter raw elements (row-major, for kernels that skip bounds checks)
+     * @return pointer to the first element
+     */
+    const float* getData() const {return _matrix; }
+
+    /**
+     * @brief getter raw elements with editing
+     * @return pointer to the first element
+     */
+    float* getData() {return _matrix; }
 
     /**
      * @brief change the matrix to column vector
@@ -78,6 +89,12 @@ public:
      */
     Matrix& vectorize();
 
+    /**
+     * @brief transposed copy of the matrix
+     * @return new cols x rows matrix
+     */
+    Matrix transpose() const;
+
     /**
      * @brief prints the matrix
      */
@@ -0,0 +1,75 @@
+/**
+ * @file MatrixHash.cpp
+ * @author  Jonathan Birnbaum
+ * @date 08/06/2020
+ *
+ * @brief hash of matrix contents implementation
+ */
+
+#include "MatrixHash.h"
+#include <algorithm>
+#include <cstring>
+
+/**
+ * @brief hash constants (64 bit golden ratio and two large odd multipliers)
+ */
+#define HASH_SEED (0x9E3779B97F4A7C15ULL)
+#define HASH_MUL_1 (0xFF51AFD7ED558CCDULL)
+#define HASH_MUL_2 (0xC4CEB9FE1A85EC53ULL)
+
+/**
+ * @brief number of independent hash lanes (keeps the multiplier pipeline busy)
+ */
+#define HASH_LANES (4)
+
+/**
+ * @brief final avalanche of a 64 bit value
+ * @param h: value to mix
+ * @return mixed value
+ */
+static uint64_t mix64(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= HASH_MUL_1;
+    h ^= h >> 33;
+    h *= HASH_MUL_2;
+    h ^= h >> 33;
+    return h;
+}
+
+/**
+ * @brief hash of the matrix elements
+ */
+uint64_t hashMatrix(const Matrix& mat)
+{
+    const unsigned char* bytes = (const unsigned char*) mat.getData();
+    size_t size = (size_t)matrixSize(mat) * sizeof(float);
+    uint64_t lanes[HASH_LANES] = {HASH_SEED, HASH_SEED ^ HASH_MUL_1, HASH_SEED ^ HASH_MUL_2, ~HASH_SEED};
+
+    size_t offset = 0;
+    for (; offset + (HASH_LANES * sizeof(uint64_t)) <= size; offset += HASH_LANES * sizeof(uint64_t))
+    {
+        for (int lane = 0; lane < HASH_LANES; lane++)
+        {
+            uint64_t word;
+            std::memcpy(&word, bytes + offset + (lane * sizeof(uint64_t)), sizeof(word));
+            lanes[lane] = (lanes[lane] ^ word) * HASH_MUL_1;
+            lanes[lane] ^= lanes[lane] >> 29;
+        }
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, bytes + offset, std::min(size - offset, sizeof(tail)));
+    for (offset += sizeof(tail); offset < size; offset += sizeof(uint32_t))
+    {
+        uint32_t word;
+        std::memcpy(&word, bytes + offset, sizeof(word));
+        tail = (tail ^ word) * HASH_MUL_2;
+    }
+
+    uint64_t h = size ^ mix64(tail);
+    for (int lane = 0; lane < HASH_LANES; lane++)
+    {
+        h = (h ^ mix64(lanes[lane])) * HASH_MUL_2;
+    }
+    return mix64(h);
+}
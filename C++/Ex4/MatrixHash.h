@@ -0,0 +1,22 @@
+/**
+ * @file MatrixHash.h
+ * @author  Jonathan Birnbaum
+ * @date 08/06/2020
+ *
+ * @brief hash of matrix contents declaration and documentation
+ */
+
+#ifndef MATRIXHASH_H
+#define MATRIXHASH_H
+
+#include <cstdint>
+#include "Matrix.h"
+
+/**
+ * @brief fast 64 bit hash of all the elements of a matrix (by their bits)
+ * @param mat: matrix to hash
+ * @return hash value
+ */
+uint64_t hashMatrix(const Matrix& mat);
+
+#endif //MATRIXHASH_H
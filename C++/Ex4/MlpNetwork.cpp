@@ -7,6 +7,11 @@
  */
 
 #include "MlpNetwork.h"
+#include "Autotuner.h"
+#include "MatrixHash.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
 
 
 /**
@@ -16,31 +21,154 @@ MlpNetwork::MlpNetwork(const Matrix* weights, const Matrix* biases) :
                         _layer1(weights[0], biases[0], Relu),
                         _layer2(weights[1], biases[1], Relu),
                         _layer3(weights[2], biases[2], Relu),
-                        _layer4(weights[3], biases[3], Softmax) {}
+                        _layer4(weights[3], biases[3], Softmax), _cache(nullptr) {}
+
+/**
+ * @brief find the most probable digit in one column of the last layer output
+ * @param output: softmax output, one column per input
+ * @param col: column to check
+ * @return digit struct with the result of this column
+ */
+static Digit maxDigit(const Matrix& output, const int col)
+{
+    float max_probability = 0;
+    int max_value = 0;
+    for (int index = 0; index < output.getRows(); index++)
+    {
+        if (output(index, col) > max_probability)
+        {
+            max_probability = output(index, col);
+            max_value = index;
+        }
+    }
+    Digit final_result;
+    final_result.value = max_value;
+    final_result.probability = max_probability;
+    return final_result;
+}
 
 /**
  * @brief operator ()
  */
 Digit MlpNetwork::operator()(Matrix &input)
 {
+    uint64_t key = 0;
+    Digit cached;
+    if (_cache != nullptr)
+    {
+        key = hashMatrix(input);
+        if (_cache->lookup(key, cached))
+        {
+            return cached;
+        }
+    }
+
     Matrix mat_after_layer = _layer1(input);
     mat_after_layer = _layer2(mat_after_layer);
     mat_after_layer = _layer3(mat_after_layer);
     mat_after_layer = _layer4(mat_after_layer);
 
+    Digit final_result = maxDigit(mat_after_layer, 0);
+    if (_cache != nullptr)
+    {
+        _cache->insert(key, final_result);
+    }
+    return final_result;
+}
 
-    float max_probability = 0;
-    int max_value = 0;
-    for (int index = 0; index < matrixSize(mat_after_layer); index++)
+/**
+ * @brief classify a batch
+ */
+void MlpNetwork::classifyBatch(Matrix& inputs, Digit* results)
+{
+    Matrix mat_after_layer = _layer1(inputs);
+    mat_after_layer = _layer2(mat_after_layer);
+    mat_after_layer = _layer3(mat_after_layer);
+    mat_after_layer = _layer4(mat_after_layer);
+
+    for (int col = 0; col < mat_after_layer.getCols(); col++)
     {
-        if (mat_after_layer[index] > max_probability)
+        results[col] = maxDigit(mat_after_layer, col);
+    }
+}
+
+/**
+ * @brief save packed weights
+ */
+bool MlpNetwork::savePackedWeights(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    return _layer1.writePacked(file) && _layer2.writePacked(file) && _layer3.writePacked(file) &&
+           _layer4.writePacked(file);
+}
+
+/**
+ * @brief load packed weights
+ */
+bool MlpNetwork::loadPackedWeights(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    // read into copies so a bad file leaves the network untouched
+    Dense layer1 = _layer1, layer2 = _layer2, layer3 = _layer3, layer4 = _layer4;
+    if (!layer1.readPacked(file) || !layer2.readPacked(file) || !layer3.readPacked(file) || !layer4.readPacked(file))
+    {
+        return false;
+    }
+    _layer1 = layer1;
+    _layer2 = layer2;
+    _layer3 = layer3;
+    _layer4 = layer4;
+    if (_cache != nullptr)
+    {
+        _cache->clear(); // results of the previous packing
+    }
+    return true;
+}
+
+/**
+ * @brief apply (and if needed create) kernel tuning
+ */
+bool MlpNetwork::applyTuning(const std::string& tuningFile, std::vector<int> batches)
+{
+    TuningTable table;
+    table.load(tuningFile); // a missing or stale file just means everything gets tuned
+    bool changed = false;
+
+    // largest batch first: it picks the panel height (the packing) the other batch sizes share
+    std::sort(batches.begin(), batches.end(), std::greater<int>());
+    Dense* layers[MLP_SIZE] = {&_layer1, &_layer2, &_layer3, &_layer4};
+    for (Dense* layer : layers)
+    {
+        int rows = layer->getWeights().getRows();
+        int cols = layer->getWeights().getCols();
+        int panelRows = 0;
+        for (int batch : batches)
         {
-            max_probability = mat_after_layer[index];
-            max_value = index;
+            KernelConfig config;
+            if (!table.find(rows, cols, batch, config) || ((panelRows != 0) && (config.panelRows != panelRows)))
+            {
+                config = tuneLayer(*layer, batch, panelRows);
+                table.set(rows, cols, batch, config);
+                changed = true;
+            }
+            panelRows = config.panelRows;
+            layer->setKernelConfig(batch, config);
+        }
+        // the tuned packing must read back, or savePackedWeights would write a file loadPackedWeights rejects
+        std::stringstream packed;
+        Dense reloaded = *layer;
+        if (!layer->writePacked(packed) || !reloaded.readPacked(packed))
+        {
+            return false;
         }
     }
-    Digit final_result;
-    final_result.value = max_value;
-    final_result.probability = max_probability;
-    return final_result;
+    return !changed || table.save(tuningFile);
 }
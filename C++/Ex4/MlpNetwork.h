@@ -9,9 +9,12 @@
 #ifndef MLPNETWORK_H
 #define MLPNETWORK_H
 
+#include <string>
+#include <vector>
 #include "Matrix.h"
 #include "Digit.h"
 #include "Dense.h"
+#include "InferenceCache.h"
 
 #define MLP_SIZE (4)
 
@@ -29,6 +32,7 @@ private:
     Dense _layer2;
     Dense _layer3;
     Dense _layer4;
+    InferenceCache* _cache;
 public:
 
     /**
@@ -45,6 +49,44 @@ public:
      */
     Digit operator()(Matrix& input);
 
+    /**
+     * @brief put a result cache in front of operator () (not owned by the network), holding only results of
+     * these weights - loadPackedWeights clears it
+     * @param cache: cache to use, nullptr to disable
+     */
+    void setCache(InferenceCache* cache) {_cache = cache; }
+
+    /**
+     * @brief classify a batch of inputs in one pass through the layers
+     * @param inputs: input matrix with one vectorized image per column
+     * @param results: array of inputs.getCols() digits to fill
+     */
+    void classifyBatch(Matrix& inputs, Digit* results);
+
+    /**
+     * @brief cache the packed weights of all layers to a file, next to the model
+     * @param path: packed weights file path
+     * @return true for success
+     */
+    bool savePackedWeights(const std::string& path) const;
+
+    /**
+     * @brief load packed weights saved by savePackedWeights instead of the packing done at construction
+     * @param path: packed weights file path
+     * @return true for success, false if the file is missing, doesn't match the layers or was saved from other
+     * weights
+     */
+    bool loadPackedWeights(const std::string& path);
+
+    /**
+     * @brief load the tuned kernel of every layer for these batch sizes, benchmarking and saving
+     * whatever the tuning file is missing (so only the first run on a host pays for tuning)
+     * @param tuningFile: local tuning file path
+     * @param batches: batch sizes to tune for
+     * @return true if the tuning file is up to date and every tuned packing reads back from the packed format
+     */
+    bool applyTuning(const std::string& tuningFile, std::vector<int> batches);
+
 };
 
 #endif // MLPNETWORK_H
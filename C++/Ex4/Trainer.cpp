@@ -0,0 +1,316 @@
+/**
+ * @file Trainer.cpp
+ * @author  Jonathan Birnbaum
+ * @date 08/06/2020
+ *
+ * @brief mini-batch training implementation
+ */
+
+#include "Trainer.h"
+#include "KernelPool.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+#include <iostream>
+#include <random>
+#include <thread>
+
+using std::endl;
+using std::cerr;
+
+/**
+ * @brief Adam constants
+ */
+#define ADAM_BETA_1 (0.9f)
+#define ADAM_BETA_2 (0.999f)
+#define ADAM_EPSILON (1e-8f)
+
+/**
+ * @brief smallest probability used in the loss (avoids log(0))
+ */
+#define LOSS_MIN_PROBABILITY (1e-12f)
+
+/**
+ * @brief pixel scale to [0, 1], same as the evaluation
+ */
+#define PIXEL_MAX_VALUE (255.0f)
+
+/**
+ * @brief error massages
+ */
+#define ERROR_MSG_DATASET_MISMATCH "Error: Images and labels count don't match"
+#define ERROR_MSG_IMAGE_SIZE "Error: Image size doesn't match the first layer weights"
+#define ERROR_MSG_BATCH_SIZE "Error: Batch size must be positive"
+#define ERROR_MSG_LABEL_RANGE "Error: Label out of the output layer range"
+
+/**
+ * @brief activation of each Ex4 layer, same as MlpNetwork
+ */
+static const ActivationType layerActivations[MLP_SIZE] = {Relu, Relu, Relu, Softmax};
+
+/**
+ * @brief Optimizer constructor
+ */
+Optimizer::Optimizer(const OptimizerType type, const float learningRate) : _type(type), _learningRate(learningRate),
+                                                                           _step(0)
+{}
+
+/**
+ * @brief Optimizer step
+ */
+void Optimizer::step(const std::vector<Matrix*>& params, const std::vector<Matrix>& grads)
+{
+    _step++;
+    if (_type == Sgd)
+    {
+        for (size_t p = 0; p < params.size(); p++)
+        {
+            float* values = params[p]->getData();
+            const float* grad = grads[p].getData();
+            for (int index = 0; index < matrixSize(*params[p]); index++)
+            {
+                values[index] -= _learningRate * grad[index];
+            }
+        }
+        return;
+    }
+
+    if (_firstMoment.empty())
+    {
+        for (const Matrix* param : params)
+        {
+            _firstMoment.emplace_back(param->getRows(), param->getCols());
+            _secondMoment.emplace_back(param->getRows(), param->getCols());
+        }
+    }
+    float correction1 = 1 - std::pow(ADAM_BETA_1, (float)_step);
+    float correction2 = 1 - std::pow(ADAM_BETA_2, (float)_step);
+    float stepSize = _learningRate * std::sqrt(correction2) / correction1;
+    for (size_t p = 0; p < params.size(); p++)
+    {
+        float* values = params[p]->getData();
+        const float* grad = grads[p].getData();
+        float* m = _firstMoment[p].getData();
+        float* v = _secondMoment[p].getData();
+        for (int index = 0; index < matrixSize(*params[p]); index++)
+        {
+            m[index] = (ADAM_BETA_1 * m[index]) + ((1 - ADAM_BETA_1) * grad[index]);
+            v[index] = (ADAM_BETA_2 * v[index]) + ((1 - ADAM_BETA_2) * grad[index] * grad[index]);
+            values[index] -= stepSize * m[index] / (std::sqrt(v[index]) + ADAM_EPSILON);
+        }
+    }
+}
+
+/**
+ * @brief He-uniform initialization
+ */
+void initWeights(Matrix* weights, Matrix* biases, const unsigned int seed)
+{
+    std::mt19937 generator(seed);
+    for (int layer = 0; layer < MLP_SIZE; layer++)
+    {
+        weights[layer] = Matrix(weightsDims[layer].rows, weightsDims[layer].cols);
+        biases[layer] = Matrix(biasDims[layer].rows, biasDims[layer].cols);
+        float limit = std::sqrt(6.0f / weightsDims[layer].cols);
+        std::uniform_real_distribution<float> distribution(-limit, limit);
+        for (int index = 0; index < matrixSize(weights[layer]); index++)
+        {
+            weights[layer][index] = distribution(generator);
+        }
+    }
+}
+
+/**
+ * @brief decode the images of a slice of the shuffled order into the columns of a batch
+ * @param images: training images
+ * @param order: shuffled image indices
+ * @param first: first position in order
+ * @param out: matrix of image size x count to fill
+ */
+static void gatherBatch(const IdxImages& images, const std::vector<int>& order, const int first, Matrix& out)
+{
+    int count = out.getCols();
+    float* values = out.getData();
+    for (int b = 0; b < count; b++)
+    {
+        const unsigned char* pixels = images.item(order[first + b]);
+        for (int index = 0; index < images.getItemSize(); index++)
+        {
+            values[((size_t)index * count) + b] = pixels[index] / PIXEL_MAX_VALUE;
+        }
+    }
+}
+
+/**
+ * @brief forward and backward pass of one slice of a mini-batch
+ * @param layers: current layers
+ * @param images: training images
+ * @param labels: training labels
+ * @param order: shuffled image indices
+ * @param first: first position of the slice in order
+ * @param count: slice size
+ * @param scale: 1 / whole mini-batch size, so slice gradients just add up
+ * @param grads: filled with weight and bias gradients of each layer (w1, b1, w2, b2, ...)
+ * @param loss: filled with the summed loss of the slice
+ */
+static void backprop(std::vector<Dense>& layers, const IdxImages& images, const IdxLabels& labels,
+                     const std::vector<int>& order, const int first, const int count, const float scale,
+                     std::vector<Matrix>& grads, float& loss)
+{
+    std::vector<Matrix> activations(MLP_SIZE + 1);
+    activations[0] = Matrix(images.getItemSize(), count);
+    gatherBatch(images, order, first, activations[0]);
+    for (int layer = 0; layer < MLP_SIZE; layer++)
+    {
+        activations[layer + 1] = layers[layer](activations[layer]);
+    }
+
+    // softmax with cross-entropy: gradient by the last layer input is (probabilities - one hot)
+    Matrix grad = activations[MLP_SIZE];
+    loss = 0;
+    for (int b = 0; b < count; b++)
+    {
+        unsigned int label = labels.label(order[first + b]);
+        loss -= std::log(std::max(grad(label, b), LOSS_MIN_PROBABILITY));
+        grad(label, b) -= 1;
+    }
+    grad = grad * scale;
+
+    for (int layer = MLP_SIZE - 1; layer >= 0; layer--)
+    {
+        if (layerActivations[layer] != Softmax)
+        {
+            grad = Activation(layerActivations[layer]).backward(activations[layer + 1], grad);
+        }
+        grad = layers[layer].backward(activations[layer], grad, grads[2 * layer], grads[(2 * layer) + 1]);
+    }
+}
+
+/**
+ * @brief training loop
+ */
+float trainNetwork(Matrix* weights, Matrix* biases, const IdxImages& images, const IdxLabels& labels,
+                   const TrainConfig& config)
+{
+    if (images.getCount() != labels.getCount())
+    {
+        cerr << ERROR_MSG_DATASET_MISMATCH << endl;
+        return TRAIN_ERROR;
+    }
+    if (images.getItemSize() != weightsDims[0].cols)
+    {
+        cerr << ERROR_MSG_IMAGE_SIZE << endl;
+        return TRAIN_ERROR;
+    }
+    // backprop indexes the output gradient by the label
+    for (int index = 0; index < labels.getCount(); index++)
+    {
+        if (labels.label(index) >= (unsigned int)weightsDims[MLP_SIZE - 1].rows)
+        {
+            cerr << ERROR_MSG_LABEL_RANGE << endl;
+            return TRAIN_ERROR;
+        }
+    }
+    if (config.batchSize <= 0)
+    {
+        cerr << ERROR_MSG_BATCH_SIZE << endl;
+        return TRAIN_ERROR;
+    }
+
+    int threads = config.threads;
+    if (threads <= 0)
+    {
+        threads = std::max(1, (int)std::thread::hardware_concurrency());
+    }
+    threads = std::min(threads, config.batchSize);
+
+    std::vector<Dense> layers;
+    std::vector<Matrix*> params;
+    for (int layer = 0; layer < MLP_SIZE; layer++)
+    {
+        layers.emplace_back(weights[layer], biases[layer], layerActivations[layer]);
+        params.push_back(&weights[layer]);
+        params.push_back(&biases[layer]);
+    }
+    Optimizer optimizer(config.optimizer, config.learningRate);
+    std::vector<std::vector<Matrix>> threadGrads(threads, std::vector<Matrix>(2 * MLP_SIZE));
+    std::vector<float> threadLoss(threads);
+
+    std::vector<int> order(images.getCount());
+    std::iota(order.begin(), order.end(), 0);
+    std::mt19937 generator(config.seed);
+    float epochLoss = 0;
+    for (int epoch = 0; epoch < config.epochs; epoch++)
+    {
+        std::shuffle(order.begin(), order.end(), generator);
+        epochLoss = 0;
+        for (int first = 0; first < (int)order.size(); first += config.batchSize)
+        {
+            int count = std::min(config.batchSize, (int)order.size() - first);
+            int workers = std::min(threads, count);
+            float scale = 1.0f / count;
+
+            // slice t of the mini-batch runs on a pool worker (slice 0 on this thread), the layers here are untuned
+            // so backprop never calls the pool itself
+            KernelPool::instance().parallelFor(workers, [&](int t)
+            {
+                int sliceFirst = first + ((count * t) / workers);
+                int sliceCount = first + ((count * (t + 1)) / workers) - sliceFirst;
+                backprop(layers, images, labels, order, sliceFirst, sliceCount, scale, threadGrads[t], threadLoss[t]);
+            });
+            for (int t = 1; t < workers; t++)
+            {
+                for (int p = 0; p < 2 * MLP_SIZE; p++)
+                {
+                    threadGrads[0][p] += threadGrads[t][p];
+                }
+            }
+            for (int t = 0; t < workers; t++)
+            {
+                epochLoss += threadLoss[t];
+            }
+            optimizer.step(params, threadGrads[0]);
+            for (int layer = 0; layer < MLP_SIZE; layer++)
+            {
+                layers[layer].setParameters(weights[layer], biases[layer]);
+            }
+        }
+        epochLoss /= std::max((size_t)1, order.size());
+    }
+    return epochLoss;
+}
+
+/**
+ * @brief write one matrix as raw floats
+ * @param path: file path
+ * @param m: matrix to write
+ * @return true for success
+ */
+static bool writeMatrix(const std::string& path, const Matrix& m)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    file.write((const char*) m.getData(), (size_t)matrixSize(m) * sizeof(float));
+    return file.good();
+}
+
+/**
+ * @brief save in the Ex4 format
+ */
+bool saveWeights(const Matrix* weights, const Matrix* biases, const std::string& directory)
+{
+    for (int layer = 0; layer < MLP_SIZE; layer++)
+    {
+        std::string index = std::to_string(layer + 1);
+        if (!writeMatrix(directory + "/w" + index, weights[layer]) ||
+            !writeMatrix(directory + "/b" + index, biases[layer]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
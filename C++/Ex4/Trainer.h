@@ -0,0 +1,109 @@
+/**
+ * @file Trainer.h
+ * @author  Jonathan Birnbaum
+ * @date 08/06/2020
+ *
+ * @brief mini-batch training declaration and documentation
+ */
+
+#ifndef TRAINER_H
+#define TRAINER_H
+
+#include <string>
+#include <vector>
+#include "Matrix.h"
+#include "MlpNetwork.h"
+#include "IdxDataset.h"
+
+/**
+ * @brief trainNetwork result for invalid data or hyper parameters (a loss is never negative)
+ */
+#define TRAIN_ERROR (-1.0f)
+
+/**
+ * @enum OptimizerType
+ * @brief Indicator of the weights update rule.
+ */
+enum OptimizerType
+{
+    Sgd,
+    Adam
+};
+
+/**
+ * @struct TrainConfig
+ * @brief training hyper parameters
+ */
+typedef struct TrainConfig
+{
+    int epochs, batchSize, threads;
+    float learningRate;
+    OptimizerType optimizer;
+    unsigned int seed;
+} TrainConfig;
+
+/**
+ * @brief default hyper parameters (Adam, 5 epochs of batches of 64 on every core)
+ */
+const TrainConfig trainConfigDefault = {5, 64, 0, 0.001f, Adam, 1};
+
+/**
+ * @brief SGD / Adam update of a list of parameter matrices
+ */
+class Optimizer
+{
+private:
+    OptimizerType _type;
+    float _learningRate;
+    int _step;
+    std::vector<Matrix> _firstMoment;
+    std::vector<Matrix> _secondMoment;
+
+public:
+
+    /**
+     * @brief constructor
+     * @param type: update rule
+     * @param learningRate: step size
+     */
+    Optimizer(OptimizerType type, float learningRate);
+
+    /**
+     * @brief apply one update
+     * @param params: parameters to update (same order and sizes on every call)
+     * @param grads: gradient of each parameter
+     */
+    void step(const std::vector<Matrix*>& params, const std::vector<Matrix>& grads);
+};
+
+/**
+ * @brief random He-uniform weights and zero biases in the Ex4 layer sizes
+ * @param weights: array of MLP_SIZE matrices to fill
+ * @param biases: array of MLP_SIZE matrices to fill
+ * @param seed: random seed
+ */
+void initWeights(Matrix* weights, Matrix* biases, unsigned int seed);
+
+/**
+ * @brief train the Ex4 network with mini-batches split between threads (data parallel)
+ * @param weights: array of MLP_SIZE weight matrices, updated in place
+ * @param biases: array of MLP_SIZE bias matrices, updated in place
+ * @param images: training images
+ * @param labels: training labels (same count as images, each below the output layer size)
+ * @param config: hyper parameters (threads 0 = every hardware thread, batchSize at least 1)
+ * @return mean cross-entropy loss of the last epoch, TRAIN_ERROR (nothing trained) if the images aren't 28x28,
+ * don't match the labels count, a label is out of range or the batch size isn't positive
+ */
+float trainNetwork(Matrix* weights, Matrix* biases, const IdxImages& images, const IdxLabels& labels,
+                   const TrainConfig& config = trainConfigDefault);
+
+/**
+ * @brief write weights and biases in the Ex4 input format (raw floats, one file per matrix)
+ * @param weights: array of MLP_SIZE weight matrices
+ * @param biases: array of MLP_SIZE bias matrices
+ * @param directory: output directory, files are w1..w4 and b1..b4
+ * @return true for success
+ */
+bool saveWeights(const Matrix* weights, const Matrix* biases, const std::string& directory);
+
+#endif //TRAINER_H
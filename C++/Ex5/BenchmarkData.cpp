@@ -0,0 +1,75 @@
+/**
+ * @file BenchmarkData.cpp
+ * @author  Jonathan Birnbaum
+ * @date 18/06/2020
+ *
+ * @brief synthetic data sets for the benchmarks
+ */
+
+#include "BenchmarkData.h"
+#include <fstream>
+#include <random>
+
+#define MIN_RATE (1)
+#define MAX_RATE (10)
+
+
+/**
+ * @brief write random features and rank files in the loadData format
+ * @param featuresPath: movies features file to write
+ * @param ranksPath: users rank file to write
+ * @param movies: number of movies
+ * @param users: number of users
+ * @param features: features per movie
+ * @param naFraction: fraction of unrated (NA) entries
+ * @param seed: random seed
+ * @return true for success
+ */
+bool writeBenchmarkData(const string& featuresPath, const string& ranksPath, const int movies, const int users,
+                        const int features, const double naFraction, const unsigned int seed)
+{
+    if ((movies < 2) || (users < 0) || (features < 1))
+    {
+        return false;
+    }
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<int> rate(MIN_RATE, MAX_RATE);
+    std::uniform_real_distribution<double> unit(0, 1);
+    std::ofstream featuresFile(featuresPath);
+    for (int movie = 0; movie < movies; movie++)
+    {
+        featuresFile << "movie" << movie;
+        for (int feature = 0; feature < features; feature++)
+        {
+            featuresFile << " " << rate(generator);
+        }
+        featuresFile << "\n";
+    }
+    std::ofstream ranksFile(ranksPath);
+    for (int movie = 0; movie < movies; movie++)
+    {
+        ranksFile << (movie == 0 ? "" : " ") << "movie" << movie;
+    }
+    ranksFile << "\n";
+    for (int user = 0; user < users; user++)
+    {
+        ranksFile << "user" << user;
+        for (int movie = 0; movie < movies; movie++)
+        {
+            bool seen = (movie == 0) || ((movie != movies - 1) && (unit(generator) >= naFraction));
+            ranksFile << " ";
+            if (seen)
+            {
+                ranksFile << rate(generator);
+            }
+            else
+            {
+                ranksFile << "NA";
+            }
+        }
+        ranksFile << "\n";
+    }
+    featuresFile.close();
+    ranksFile.close();
+    return !featuresFile.fail() && !ranksFile.fail();
+}
@@ -0,0 +1,34 @@
+/**
+* @file BenchmarkData.h
+* @author  Jonathan Birnbaum
+* @date 18/06/2020
+*
+* @brief synthetic data sets for the benchmarks
+*/
+
+#ifndef EX5_BENCHMARKDATA_H
+#define EX5_BENCHMARKDATA_H
+
+#include <string>
+
+using std::string;
+
+#define DEFAULT_DATA_SEED (1)
+
+/**
+ * @brief write random features and rank files in the loadData format. Movies are named movie0, movie1, ... and
+ * users user0, user1, ...; features and ratings are integers in 1-10. Every user rates movie0 and leaves the last
+ * movie unrated, so both recommendation algorithms have work for every user
+ * @param featuresPath: movies features file to write
+ * @param ranksPath: users rank file to write
+ * @param movies: number of movies, at least 2
+ * @param users: number of users
+ * @param features: features per movie
+ * @param naFraction: fraction of unrated (NA) entries
+ * @param seed: random seed, the same arguments always write the same files
+ * @return true for success
+ */
+bool writeBenchmarkData(const string& featuresPath, const string& ranksPath, int movies, int users, int features,
+                        double naFraction, unsigned int seed = DEFAULT_DATA_SEED);
+
+#endif //EX5_BENCHMARKDATA_H
@@ -0,0 +1,225 @@
+/**
+ * @file ContentIndex.cpp
+ * @author  Jonathan Birnbaum
+ * @date 18/06/2020
+ *
+ * @brief ContentIndex class implementation
+ */
+
+#include "ContentIndex.h"
+#include "ParallelFor.h"
+#include "TopK.h"
+#include "VectorKernels.h"
+#include <algorithm>
+#include <cmath>
+
+#define KMEANS_ITERATIONS (10)
+#define KMEANS_SAMPLES_PER_LIST (64) // centroids are trained on a sample, then every movie is assigned once
+
+
+/**
+ * @brief scale a vector to unit norm, a zero vector stays zero
+ * @param vec: vector to normalize
+ * @param vectorSize: size of the vector
+ */
+static void normalize(Real* vec, const int vectorSize)
+{
+    Real norm = vectorNorm(vec, vectorSize);
+    for (int index = 0; (index < vectorSize) && (norm > 0); index++)
+    {
+        vec[index] /= norm;
+    }
+}
+
+
+/**
+ * @brief closest centroid by inner product
+ * @param centroids: row-major unit centroids
+ * @param lists: number of centroids
+ * @param vec: unit vector
+ * @param vectorSize: size of the vectors
+ * @return centroid index (lower index on ties)
+ */
+static int closestCentroid(const Real* centroids, const int lists, const Real* vec, const int vectorSize)
+{
+    int best = 0;
+    Real bestScore = dotProduct(centroids, vec, vectorSize);
+    for (int list = 1; list < lists; list++)
+    {
+        Real score = dotProduct(centroids + ((size_t)list * vectorSize), vec, vectorSize);
+        if (score > bestScore)
+        {
+            bestScore = score;
+            best = list;
+        }
+    }
+    return best;
+}
+
+
+/**
+ * @brief cluster the movies and fill the lists
+ */
+void ContentIndex::build(const Real* unitRows, const Real* rows, const Real* norms, const int numberMovies,
+                         const int numberFeatures, const int lists, const int threads)
+{
+    clear();
+    if (numberMovies <= 0)
+    {
+        return;
+    }
+    _numberFeatures = numberFeatures;
+    _numberLists = (lists > 0) ? std::min(lists, numberMovies) : std::max(1, (int)std::sqrt((double)numberMovies));
+
+    // spherical k-means on an evenly spaced sample, seeded by evenly spaced movies
+    int numberSamples = (int)std::min((long long)numberMovies, (long long)_numberLists * KMEANS_SAMPLES_PER_LIST);
+    vector<int> samples(numberSamples);
+    for (int sample = 0; sample < numberSamples; sample++)
+    {
+        samples[sample] = (int)(((long long)sample * numberMovies) / numberSamples);
+    }
+    _centroids.resize((size_t)_numberLists * numberFeatures);
+    for (int list = 0; list < _numberLists; list++)
+    {
+        const Real* seed = unitRows + ((size_t)samples[((long long)list * numberSamples) / _numberLists] *
+                                      numberFeatures);
+        std::copy(seed, seed + numberFeatures, _centroids.begin() + ((size_t)list * numberFeatures));
+    }
+    vector<int> assignment(numberSamples);
+    for (int iteration = 0; iteration < KMEANS_ITERATIONS; iteration++)
+    {
+        parallelFor(numberSamples, threads, [&](int begin, int end)
+        {
+            for (int sample = begin; sample < end; sample++)
+            {
+                assignment[sample] = closestCentroid(_centroids.data(), _numberLists,
+                                                     unitRows + ((size_t)samples[sample] * numberFeatures),
+                                                     numberFeatures);
+            }
+        });
+        vector<Real> sums(_centroids.size());
+        vector<int> counts(_numberLists);
+        for (int sample = 0; sample < numberSamples; sample++)
+        {
+            const Real* row = unitRows + ((size_t)samples[sample] * numberFeatures);
+            Real* sum = &sums[(size_t)assignment[sample] * numberFeatures];
+            for (int feature = 0; feature < numberFeatures; feature++)
+            {
+                sum[feature] += row[feature];
+            }
+            counts[assignment[sample]]++;
+        }
+        for (int list = 0; list < _numberLists; list++)
+        {
+            // an empty cluster keeps its centroid
+            if (counts[list] > 0)
+            {
+                normalize(&sums[(size_t)list * numberFeatures], numberFeatures);
+                std::copy(sums.begin() + ((size_t)list * numberFeatures),
+                          sums.begin() + ((size_t)(list + 1) * numberFeatures),
+                          _centroids.begin() + ((size_t)list * numberFeatures));
+            }
+        }
+    }
+
+    // every movie goes to its closest centroid, lists keep ascending ids
+    vector<int> movieList(numberMovies);
+    parallelFor(numberMovies, threads, [&](int begin, int end)
+    {
+        for (int movie = begin; movie < end; movie++)
+        {
+            movieList[movie] = closestCentroid(_centroids.data(), _numberLists,
+                                               unitRows + ((size_t)movie * numberFeatures), numberFeatures);
+        }
+    });
+    _listStart.assign(_numberLists + 1, 0);
+    for (int movie = 0; movie < numberMovies; movie++)
+    {
+        _listStart[movieList[movie] + 1]++;
+    }
+    for (int list = 0; list < _numberLists; list++)
+    {
+        _listStart[list + 1] += _listStart[list];
+    }
+    vector<size_t> next(_listStart.begin(), _listStart.end() - 1);
+    _ids.resize(numberMovies);
+    _vectors.resize((size_t)numberMovies * numberFeatures);
+    _norms.resize(numberMovies);
+    for (int movie = 0; movie < numberMovies; movie++)
+    {
+        size_t position = next[movieList[movie]]++;
+        _ids[position] = movie;
+        std::copy(rows + ((size_t)movie * numberFeatures), rows + ((size_t)(movie + 1) * numberFeatures),
+                  _vectors.begin() + (position * numberFeatures));
+        _norms[position] = norms[movie];
+    }
+}
+
+
+/**
+ * @brief best movie for a query
+ */
+int ContentIndex::search(const Real* query, const int nprobe, const int* excluded, const int numberExcluded) const
+{
+    if (isEmpty())
+    {
+        return -1;
+    }
+    vector<Real> scores(_numberLists);
+    dotProducts(query, _centroids.data(), _numberLists, _numberFeatures, scores.data());
+    vector<ScoredId> lists(_numberLists);
+    for (int list = 0; list < _numberLists; list++)
+    {
+        lists[list] = ScoredId(list, scores[list]);
+    }
+    selectTopK(lists, std::max(1, nprobe));
+
+    // the query norm is computed as the preference vector norm is, so a full probe scores like recommendByContent
+    Real queryNorm = vectorNorm(query, _numberFeatures);
+    const int* excludedEnd = excluded + numberExcluded;
+    int best = -1;
+    Real bestScore = 0;
+    for (const auto& _list : lists)
+    {
+        size_t listBegin = _listStart[_list.first];
+        scan(query, queryNorm, _ids.data() + listBegin, _vectors.data() + (listBegin * _numberFeatures),
+             _norms.data() + listBegin, (int)(_listStart[_list.first + 1] - listBegin), excluded, excludedEnd, scores,
+             best, bestScore);
+    }
+    scan(query, queryNorm, _addedIds.data(), _addedVectors.data(), _addedNorms.data(), (int)_addedIds.size(),
+         excluded, excludedEnd, scores, best, bestScore);
+    return best;
+}
+
+
+/**
+ * @brief scan rows for the best movie
+ */
+void ContentIndex::scan(const Real* query, const Real queryNorm, const int* ids, const Real* vectors,
+                        const Real* norms, const int count, const int* excluded, const int* excludedEnd,
+                        vector<Real>& scores, int& best, Real& bestScore) const
+{
+    scores.resize(std::max((int)scores.size(), count));
+    dotProducts(query, vectors, count, _numberFeatures, scores.data());
+    for (int position = 0; position < count; position++)
+    {
+        scores[position] = cosineSimilarity(scores[position], queryNorm, norms[position]);
+        if (((best == -1) || scoredBefore(ScoredId(ids[position], scores[position]), ScoredId(best, bestScore))) &&
+            !std::binary_search(excluded, excludedEnd, ids[position]))
+        {
+            best = ids[position];
+            bestScore = scores[position];
+        }
+    }
+}
+
+
+/**
+ * @brief add a movie to the index
+ */
+void ContentIndex::insert(const int movieId, const Real* row, const Real norm)
+{
+    _addedIds.push_back(movieId);
+    _addedVectors.insert(_addedVectors.end(), row, row + _numberFeatures);
+    _addedNorms.push_back(norm);
+}
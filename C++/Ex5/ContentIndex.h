@@ -0,0 +1,110 @@
+/**
+* @file ContentIndex.h
+* @author  Jonathan Birnbaum
+* @date 18/06/2020
+*
+* @brief ContentIndex class declaration and documentation
+*/
+
+#ifndef EX5_CONTENTINDEX_H
+#define EX5_CONTENTINDEX_H
+
+#include <cstddef>
+#include <vector>
+#include "Real.h"
+
+using std::vector;
+
+/**
+ * @brief inverted-file (IVF) index for cosine similarity search over the movie vectors: movies are clustered by
+ * spherical k-means on their unit vectors, and a query only scans the lists of its nprobe closest centroids, scoring
+ * them as recommendByContent does
+ */
+class ContentIndex
+{
+    private:
+        int             _numberFeatures;
+        int             _numberLists;
+        vector<Real>    _centroids; // row-major (list, feature) unit centroids
+        vector<size_t>  _listStart; // _numberLists + 1 offsets into _ids / _vectors
+        vector<int>     _ids; // movie ids grouped by list
+        vector<Real>    _vectors; // row-major feature rows matching _ids
+        vector<Real>    _norms; // norm of every row of _vectors
+        vector<int>     _addedIds; // movies inserted after build, scanned by every search
+        vector<Real>    _addedVectors;
+        vector<Real>    _addedNorms;
+
+        /**
+         * @brief scan rows for the best movie not excluded
+         * @param query: numberFeatures values
+         * @param queryNorm: norm of the query
+         * @param ids: movie id of each row
+         * @param vectors: row-major feature rows
+         * @param norms: norm of each row
+         * @param count: number of rows
+         * @param excluded: ascending movie ids to skip
+         * @param excludedEnd: past the last excluded id
+         * @param scores: scratch buffer
+         * @param best: best movie so far, updated
+         * @param bestScore: its score, updated
+         */
+        void scan(const Real* query, Real queryNorm, const int* ids, const Real* vectors, const Real* norms, int count,
+                  const int* excluded, const int* excludedEnd, vector<Real>& scores, int& best, Real& bestScore) const;
+
+    public:
+
+        /**
+         * @brief constructor - empty index
+         */
+        ContentIndex() : _numberFeatures(0), _numberLists(0), _listStart(1, 0) {}
+
+        /**
+         * @brief cluster the movies and fill the lists
+         * @param unitRows: row-major movie features divided by their norm, to cluster
+         * @param rows: row-major movie features, to score
+         * @param norms: norm of every movie
+         * @param numberMovies: movies to index (ids 0..numberMovies-1)
+         * @param numberFeatures: features per movie
+         * @param lists: number of lists, 0 or less for sqrt(numberMovies)
+         * @param threads: number of threads, 0 or less for every hardware thread
+         */
+        void build(const Real* unitRows, const Real* rows, const Real* norms, int numberMovies, int numberFeatures,
+                   int lists, int threads);
+
+        /**
+         * @brief add a movie to a built index, searched by every query until the next build
+         * @param movieId: id of the new movie (above every indexed id)
+         * @param row: its features
+         * @param norm: its norm
+         */
+        void insert(int movieId, const Real* row, Real norm);
+
+        /**
+         * @brief drop the index
+         */
+        void clear() {*this = ContentIndex(); }
+
+        /**
+         * @brief check if the index was built
+         * @return true if there is nothing to search
+         */
+        bool isEmpty() const {return _ids.empty(); }
+
+        /**
+         * @brief getter number of lists
+         * @return lists of the index, probing all of them is an exact scan
+         */
+        int getNumberLists() const {return _numberLists; }
+
+        /**
+         * @brief best movie for a query, skipping excluded ones
+         * @param query: numberFeatures values (any norm, the ranking is by cosine)
+         * @param nprobe: lists scanned - more is higher recall and latency
+         * @param excluded: ascending movie ids to skip
+         * @param numberExcluded: number of excluded ids
+         * @return movie with the highest cosine similarity (lower id on ties), -1 if the probed lists hold none
+         */
+        int search(const Real* query, int nprobe, const int* excluded, int numberExcluded) const;
+};
+
+#endif //EX5_CONTENTINDEX_H
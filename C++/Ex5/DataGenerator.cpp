@@ -0,0 +1,31 @@
+/**
+ * @file DataGenerator.cpp
+ * @author  Jonathan Birnbaum
+ * @date 18/06/2020
+ *
+ * @brief writes a random data set in the loadData format
+ */
+
+#include "BenchmarkData.h"
+#include <cstdlib>
+#include <iostream>
+
+#define USAGE "Usage: DataGenerator <features file> <ranks file> <movies> <users> <features> <NA fraction> [seed]"
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 7)
+    {
+        std::cerr << USAGE << std::endl;
+        return EXIT_FAILURE;
+    }
+    unsigned int seed = (argc > 7) ? (unsigned int)std::strtoul(argv[7], nullptr, 10) : DEFAULT_DATA_SEED;
+    if (!writeBenchmarkData(argv[1], argv[2], std::atoi(argv[3]), std::atoi(argv[4]), std::atoi(argv[5]),
+                            std::atof(argv[6]), seed))
+    {
+        std::cerr << "Failed to write " << argv[1] << " and " << argv[2] << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
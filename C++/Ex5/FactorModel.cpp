@@ -0,0 +1,200 @@
+/**
+ * @file FactorModel.cpp
+ * @author  Jonathan Birnbaum
+ * @date 18/06/2020
+ *
+ * @brief FactorModel class implementation
+ */
+
+#include "FactorModel.h"
+#include "ParallelFor.h"
+#include "VectorKernels.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#define DEFAULT_FACTORS (16)
+#define DEFAULT_ITERATIONS (10)
+#define DEFAULT_REGULARIZATION (0.1)
+#define FACTOR_SEED (1)
+#define FACTOR_INIT_SCALE (0.1)
+
+
+/**
+ * @brief solve a symmetric positive definite system by Cholesky decomposition
+ * @param matrix: row-major size x size matrix, overwritten by its lower factor
+ * @param vec: right hand side, overwritten by the solution
+ * @param size: size of the system
+ */
+static void choleskySolve(double* matrix, double* vec, const int size)
+{
+    for (int col = 0; col < size; col++)
+    {
+        double* colRow = matrix + ((size_t)col * size);
+        colRow[col] = std::sqrt(colRow[col] - dotProduct(colRow, colRow, col));
+        for (int row = col + 1; row < size; row++)
+        {
+            double* rowValues = matrix + ((size_t)row * size);
+            rowValues[col] = (rowValues[col] - dotProduct(rowValues, colRow, col)) / colRow[col];
+        }
+    }
+    // forward substitution with L, then backward with its transpose
+    for (int row = 0; row < size; row++)
+    {
+        const double* rowValues = matrix + ((size_t)row * size);
+        vec[row] = (vec[row] - dotProduct(rowValues, vec, row)) / rowValues[row];
+    }
+    for (int row = size - 1; row >= 0; row--)
+    {
+        double sum = vec[row];
+        for (int next = row + 1; next < size; next++)
+        {
+            sum -= matrix[((size_t)next * size) + row] * vec[next];
+        }
+        vec[row] = sum / matrix[((size_t)row * size) + row];
+    }
+}
+
+
+/**
+ * @brief regularized least squares factors of one row
+ */
+void FactorModel::solveRow(const int* ids, const Real* rates, const int count, const double* otherFactors,
+                           double* factors) const
+{
+    std::fill(factors, factors + _numberFactors, 0);
+    if (count == 0)
+    {
+        return;
+    }
+
+    // normal equations (sum v v^T + lambda * count * I) x = sum (rate - mean) v, lower triangle only
+    vector<double> matrix((size_t)_numberFactors * _numberFactors);
+    for (int index = 0; index < count; index++)
+    {
+        const double* other = otherFactors + ((size_t)ids[index] * _numberFactors);
+        double residual = rates[index] - _mean;
+        for (int row = 0; row < _numberFactors; row++)
+        {
+            double* matrixRow = &matrix[(size_t)row * _numberFactors];
+            for (int col = 0; col <= row; col++)
+            {
+                matrixRow[col] += other[row] * other[col];
+            }
+            factors[row] += residual * other[row];
+        }
+    }
+    for (int row = 0; row < _numberFactors; row++)
+    {
+        matrix[((size_t)row * _numberFactors) + row] += _regularization * count;
+    }
+    choleskySolve(matrix.data(), factors, _numberFactors);
+}
+
+
+/**
+ * @brief learn the factors
+ */
+void FactorModel::train(const RatingMatrix& ratings, const int numberMovies, const int factors, const int iterations,
+                        const double regularization, const int threads)
+{
+    clear();
+    _numberFactors = (factors > 0) ? factors : DEFAULT_FACTORS;
+    _numberUsers = ratings.numberRows();
+    _numberMovies = numberMovies;
+    _regularization = (regularization > 0) ? regularization : DEFAULT_REGULARIZATION;
+
+    // movie columns of the ratings, to solve the movies like the users
+    vector<size_t> movieStart(numberMovies + 1, 0);
+    double sum = 0;
+    for (int user = 0; user < _numberUsers; user++)
+    {
+        for (int index = 0; index < ratings.rowSize(user); index++)
+        {
+            movieStart[ratings.movies(user)[index] + 1]++;
+            sum += ratings.rates(user)[index];
+        }
+    }
+    for (int movie = 0; movie < numberMovies; movie++)
+    {
+        movieStart[movie + 1] += movieStart[movie];
+    }
+    _mean = (movieStart[numberMovies] == 0) ? 0 : sum / movieStart[numberMovies];
+    vector<int> movieUsers(movieStart[numberMovies]);
+    vector<Real> movieRates(movieStart[numberMovies]);
+    vector<size_t> next(movieStart.begin(), movieStart.end() - 1);
+    for (int user = 0; user < _numberUsers; user++)
+    {
+        for (int index = 0; index < ratings.rowSize(user); index++)
+        {
+            size_t position = next[ratings.movies(user)[index]]++;
+            movieUsers[position] = user;
+            movieRates[position] = ratings.rates(user)[index];
+        }
+    }
+
+    std::mt19937 generator(FACTOR_SEED);
+    std::uniform_real_distribution<double> initial(-FACTOR_INIT_SCALE, FACTOR_INIT_SCALE);
+    _movieFactors.resize((size_t)numberMovies * _numberFactors);
+    for (double& _factor : _movieFactors)
+    {
+        _factor = initial(generator);
+    }
+    _userFactors.resize((size_t)_numberUsers * _numberFactors);
+
+    // every row of a half iteration only reads the other side, so the rows are solved in parallel
+    for (int iteration = 0; iteration < ((iterations > 0) ? iterations : DEFAULT_ITERATIONS); iteration++)
+    {
+        parallelFor(_numberUsers, threads, [&](int begin, int end)
+        {
+            for (int user = begin; user < end; user++)
+            {
+                solveRow(ratings.movies(user), ratings.rates(user), ratings.rowSize(user), _movieFactors.data(),
+                         &_userFactors[(size_t)user * _numberFactors]);
+            }
+        });
+        parallelFor(numberMovies, threads, [&](int begin, int end)
+        {
+            for (int movie = begin; movie < end; movie++)
+            {
+                solveRow(movieUsers.data() + movieStart[movie], movieRates.data() + movieStart[movie],
+                         (int)(movieStart[movie + 1] - movieStart[movie]), _userFactors.data(),
+                         &_movieFactors[(size_t)movie * _numberFactors]);
+            }
+        });
+    }
+}
+
+
+/**
+ * @brief solve the factors of one user again
+ */
+void FactorModel::updateUser(const RatingMatrix& ratings, const int userId)
+{
+    if (userId == _numberUsers)
+    {
+        _numberUsers++;
+        _userFactors.resize((size_t)_numberUsers * _numberFactors);
+    }
+    solveRow(ratings.movies(userId), ratings.rates(userId), ratings.rowSize(userId), _movieFactors.data(),
+             &_userFactors[(size_t)userId * _numberFactors]);
+}
+
+
+/**
+ * @brief add a movie without ratings
+ */
+void FactorModel::addMovie()
+{
+    _numberMovies++;
+    _movieFactors.resize((size_t)_numberMovies * _numberFactors, 0);
+}
+
+
+/**
+ * @brief predicted rate
+ */
+double FactorModel::predict(const int userId, const int movieId) const
+{
+    return _mean + dotProduct(userFactors(userId), movieFactors(movieId), _numberFactors);
+}
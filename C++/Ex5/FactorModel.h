@@ -0,0 +1,124 @@
+/**
+* @file FactorModel.h
+* @author  Jonathan Birnbaum
+* @date 18/06/2020
+*
+* @brief FactorModel class declaration and documentation
+*/
+
+#ifndef EX5_FACTORMODEL_H
+#define EX5_FACTORMODEL_H
+
+#include <cstddef>
+#include <vector>
+#include "RatingMatrix.h"
+
+using std::vector;
+
+/**
+ * @brief matrix factorization of the ratings: every user and movie gets a vector of latent factors, learned by
+ * alternating least squares (ALS), and a rate is predicted as the mean rate plus one dot product
+ */
+class FactorModel
+{
+    private:
+        int             _numberFactors;
+        int             _numberUsers;
+        int             _numberMovies;
+        double          _regularization;
+        double          _mean; // mean rate of the training ratings
+        vector<double>  _userFactors; // row-major (user, factor)
+        vector<double>  _movieFactors; // row-major (movie, factor)
+
+        /**
+         * @brief regularized least squares factors of one row, the other side's factors fixed
+         * @param ids: ids of the rated other side rows
+         * @param rates: matching rates
+         * @param count: number of ratings
+         * @param otherFactors: row-major factors of the other side
+         * @param factors: filled with the numberFactors solution, zero without ratings
+         */
+        void solveRow(const int* ids, const Real* rates, int count, const double* otherFactors,
+                      double* factors) const;
+
+    public:
+
+        /**
+         * @brief constructor - empty (untrained) model
+         */
+        FactorModel() : _numberFactors(0), _numberUsers(0), _numberMovies(0), _regularization(0), _mean(0) {}
+
+        /**
+         * @brief learn the factors, every half iteration solving all users (then all movies) in parallel
+         * @param ratings: user rows of ratings
+         * @param numberMovies: number of movies (ids 0..numberMovies-1)
+         * @param factors: factors per vector, 0 or less for the default
+         * @param iterations: alternations, 0 or less for the default
+         * @param regularization: penalty on the factors per rating, 0 or less for the default
+         * @param threads: number of threads, 0 or less for every hardware thread
+         */
+        void train(const RatingMatrix& ratings, int numberMovies, int factors, int iterations,
+                   double regularization, int threads);
+
+        /**
+         * @brief solve the factors of one user again with the movie factors fixed, after the user's ratings changed
+         * @param ratings: user rows of ratings
+         * @param userId: user id, the next id adds a user
+         */
+        void updateUser(const RatingMatrix& ratings, int userId);
+
+        /**
+         * @brief add a movie without ratings (zero factors) at the end
+         */
+        void addMovie();
+
+        /**
+         * @brief drop the model
+         */
+        void clear() {*this = FactorModel(); }
+
+        /**
+         * @brief check if the model was trained
+         * @return true if there is nothing to predict with
+         */
+        bool isEmpty() const {return _numberFactors == 0; }
+
+        /**
+         * @brief getter factors per vector
+         * @return number of latent factors
+         */
+        int getNumberFactors() const {return _numberFactors; }
+
+        /**
+         * @brief getter mean rate
+         * @return the rate predicted for zero factors
+         */
+        double getMean() const {return _mean; }
+
+        /**
+         * @brief factors of a user
+         * @param userId: user id
+         * @return pointer to getNumberFactors() values
+         */
+        const double* userFactors(int userId) const {return _userFactors.data() + ((size_t)userId * _numberFactors); }
+
+        /**
+         * @brief factors of a movie
+         * @param movieId: movie id
+         * @return pointer to getNumberFactors() values, the next movies follow
+         */
+        const double* movieFactors(int movieId) const
+        {
+            return _movieFactors.data() + ((size_t)movieId * _numberFactors);
+        }
+
+        /**
+         * @brief predicted rate
+         * @param userId: user id
+         * @param movieId: movie id
+         * @return mean rate plus the dot product of the factors
+         */
+        double predict(int userId, int movieId) const;
+};
+
+#endif //EX5_FACTORMODEL_H
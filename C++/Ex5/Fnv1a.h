@@ -0,0 +1,35 @@
+/**
+* @file Fnv1a.h
+* @author  Jonathan Birnbaum
+* @date 18/06/2020
+*
+* @brief FNV-1a hash of raw bytes
+*/
+
+#ifndef EX5_FNV1A_H
+#define EX5_FNV1A_H
+
+#include <cstddef>
+#include <cstdint>
+
+#define FNV_OFFSET_BASIS (14695981039346656037ULL)
+#define FNV_PRIME (1099511628211ULL)
+
+/**
+ * @brief 64 bit FNV-1a hash, the same in every process and build
+ * @param data: bytes to hash
+ * @param size: number of bytes
+ * @param hash: hash of the bytes before these, to hash several buffers as one
+ * @return hash value
+ */
+inline uint64_t fnv1a(const void* data, const size_t size, uint64_t hash = FNV_OFFSET_BASIS)
+{
+    const unsigned char* bytes = (const unsigned char*) data;
+    for (size_t index = 0; index < size; index++)
+    {
+        hash = (hash ^ bytes[index]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+#endif //EX5_FNV1A_H
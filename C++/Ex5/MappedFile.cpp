@@ -0,0 +1,64 @@
+/**
+ * @file MappedFile.cpp
+ * @author  Jonathan Birnbaum
+ * @date 18/06/2020
+ *
+ * @brief MappedFile class implementation
+ */
+
+#include "MappedFile.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+/**
+ * @brief map a file
+ * @param path: file path
+ * @return true for success
+ */
+bool MappedFile::open(const std::string& path)
+{
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat fileStat{};
+    if (fstat(fd, &fileStat) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    if (fileStat.st_size == 0)
+    {
+        ::close(fd);
+        return true;
+    }
+    void* mapped = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED)
+    {
+        return false;
+    }
+    madvise(mapped, (size_t)fileStat.st_size, MADV_SEQUENTIAL);
+    _mapped = mapped;
+    _size = (size_t)fileStat.st_size;
+    return true;
+}
+
+
+/**
+ * @brief unmap the file
+ */
+void MappedFile::close()
+{
+    if (_mapped != nullptr)
+    {
+        munmap(_mapped, _size);
+    }
+    _mapped = nullptr;
+    _size = 0;
+}
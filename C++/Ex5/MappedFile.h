@@ -0,0 +1,64 @@
+/**
+* @file MappedFile.h
+* @author  Jonathan Birnbaum
+* @date 18/06/2020
+*
+* @brief MappedFile class declaration and documentation
+*/
+
+#ifndef EX5_MAPPEDFILE_H
+#define EX5_MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief read-only memory mapping of a whole file
+ */
+class MappedFile
+{
+    private:
+        void*   _mapped;
+        size_t  _size;
+
+    public:
+
+        /**
+         * @brief constructor - nothing mapped
+         */
+        MappedFile() : _mapped(nullptr), _size(0) {}
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        /**
+         * @brief destructor - unmaps the file
+         */
+        ~MappedFile() {close(); }
+
+        /**
+         * @brief map a file
+         * @param path: file path
+         * @return true for success (an empty file maps to no data)
+         */
+        bool open(const std::string& path);
+
+        /**
+         * @brief unmap the file
+         */
+        void close();
+
+        /**
+         * @brief getter file content
+         * @return first byte of the mapping (nullptr for an empty file)
+         */
+        const char* data() const {return (const char*) _mapped; }
+
+        /**
+         * @brief getter file size
+         * @return number of bytes
+         */
+        size_t size() const {return _size; }
+};
+
+#endif //EX5_MAPPEDFILE_H
@@ -0,0 +1,95 @@
+/**
+ * @file NeighbourValidation.cpp
+ * @author  Jonathan Birnbaum
+ * @date 18/06/2020
+ *
+ * @brief CF through a top-M similarity cache for users who have seen none of a movie's neighbours: the rate falls
+ * back to the exact scan instead of 0 / 0. Exits with failure on a NaN or a rate different from the scan
+ */
+
+#include "BenchmarkData.h"
+#include "RecommenderSystem.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+#define SMALL_FEATURES_PATH "neighbour_small_features.txt"
+#define SMALL_RANKS_PATH "neighbour_small_ranks.txt"
+#define FEATURES_PATH "neighbour_features.txt"
+#define RANKS_PATH "neighbour_ranks.txt"
+#define MOVIES (600)
+#define USERS (200)
+#define FEATURES (20)
+#define NA_FRACTION (0.95)
+#define TOP_M (2)
+#define K (10)
+
+
+/**
+ * @brief two pairs of similar movies, the user only rated one movie of the first pair, so the top-2 neighbours of
+ * the second pair (themselves) are unseen
+ * @return 0 if the cached rate of an unseen neighbourhood is the scan's rate
+ */
+static int validateNoSeenNeighbour()
+{
+    std::ofstream features(SMALL_FEATURES_PATH);
+    features << "movieA 9 1\nmovieB 8 1\nmovieC 1 9\nmovieD 1 8\n";
+    features.close();
+    std::ofstream ranks(SMALL_RANKS_PATH);
+    ranks << "movieA movieB movieC movieD\nuser 7 NA NA NA\n";
+    ranks.close();
+
+    RecommenderSystem exact;
+    RecommenderSystem cached;
+    if ((exact.loadData(SMALL_FEATURES_PATH, SMALL_RANKS_PATH) != 0) ||
+        (cached.loadData(SMALL_FEATURES_PATH, SMALL_RANKS_PATH) != 0))
+    {
+        printf("failed to load the small data set\n");
+        return EXIT_FAILURE;
+    }
+    cached.buildSimilarityCache(TOP_M);
+    double expected = exact.predictMovieScoreForUser("movieC", "user", K);
+    double rate = cached.predictMovieScoreForUser("movieC", "user", K);
+    printf("no seen neighbour: cached %g, scan %g\n", rate, expected);
+    return (rate == expected) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+/**
+ * @brief the CF rates of every unseen movie of every user of a sparse data set, through a top-2 cache
+ * @return 0 if none is NaN
+ */
+static int validateSparseUsers()
+{
+    RecommenderSystem cached;
+    if (!writeBenchmarkData(FEATURES_PATH, RANKS_PATH, MOVIES, USERS, FEATURES, NA_FRACTION) ||
+        (cached.loadData(FEATURES_PATH, RANKS_PATH) != 0))
+    {
+        printf("failed to write or load the benchmark data set\n");
+        return EXIT_FAILURE;
+    }
+    cached.buildSimilarityCache(TOP_M);
+    int nanUsers = 0;
+    for (int user = 0; user < USERS; user++)
+    {
+        for (const auto& _scored : cached.recommendTopNByCF("user" + std::to_string(user), MOVIES, K))
+        {
+            if (std::isnan(_scored.second))
+            {
+                nanUsers++;
+                break;
+            }
+        }
+    }
+    printf("users with a NaN rate: %d of %d\n", nanUsers, USERS);
+    return (nanUsers == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+int main()
+{
+    int smallResult = validateNoSeenNeighbour();
+    int sparseResult = validateSparseUsers();
+    return ((smallResult == EXIT_SUCCESS) && (sparseResult == EXIT_SUCCESS)) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
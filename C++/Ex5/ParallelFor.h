@@ -0,0 +1,82 @@
+/**
+* @file ParallelFor.h
+* @author  Jonathan Birnbaum
+* @date 18/06/2020
+*
+* @brief splitting an index range between threads
+*/
+
+#ifndef EX5_PARALLELFOR_H
+#define EX5_PARALLELFOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief number of threads to use
+ * @param threads: requested threads, 0 or less for every hardware thread
+ * @return at least 1
+ */
+inline int resolveThreads(int threads)
+{
+    if (threads <= 0)
+    {
+        threads = (int)std::thread::hardware_concurrency();
+    }
+    return std::max(1, threads);
+}
+
+/**
+ * @brief run function(begin, end) on contiguous chunks of [0, count), one chunk per thread
+ * @param count: size of the range
+ * @param threads: number of threads, 0 or less for every hardware thread
+ * @param function: callable taking the chunk bounds (int begin, int end)
+ */
+template <class Function>
+void parallelFor(int count, int threads, Function function)
+{
+    threads = std::min(resolveThreads(threads), std::max(1, count));
+    if (threads == 1)
+    {
+        function(0, count);
+        return;
+    }
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; t++)
+    {
+        workers.emplace_back(function, (int)(((long long)count * t) / threads),
+                             (int)(((long long)count * (t + 1)) / threads));
+    }
+    function(0, count / threads);
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+/**
+ * @brief run function(begin, end) on chunks of [0, count) of size grain, threads taking the next free chunk,
+ * so uneven work per index still keeps every thread busy
+ * @param count: size of the range
+ * @param threads: number of threads, 0 or less for every hardware thread
+ * @param grain: indices per chunk
+ * @param function: callable taking the chunk bounds (int begin, int end)
+ */
+template <class Function>
+void parallelForChunks(int count, int threads, int grain, Function function)
+{
+    grain = std::max(1, grain);
+    int chunks = (count + grain - 1) / grain;
+    std::atomic<int> nextChunk(0);
+    parallelFor(chunks, threads, [&](int, int)
+    {
+        for (int chunk = nextChunk++; chunk < chunks; chunk = nextChunk++)
+        {
+            function(chunk * grain, std::min(count, (chunk + 1) * grain));
+        }
+    });
+}
+
+#endif //EX5_PARALLELFOR_H
@@ -0,0 +1,102 @@
+/**
+ * @file PrecisionValidation.cpp
+ * @author  Jonathan Birnbaum
+ * @date 18/06/2020
+ *
+ * @brief top-1 recommendations of every user by content and by CF, written to a results file and optionally
+ * compared with the results of another build. The float32 validation run on a benchmark data set:
+ *     DataGenerator features.txt ranks.txt 2000 2000 20 0.95
+ *     PrecisionValidation features.txt ranks.txt float64.txt
+ *     PrecisionValidationFloat32 features.txt ranks.txt float32.txt float64.txt
+ * the last one reports how many top-1 recommendations float32 changes
+ */
+
+#include "RecommenderSystem.h"
+#include "Real.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#define USAGE "Usage: PrecisionValidation <features file> <ranks file> <results file> [reference results file]"
+#define VALIDATION_K (10)
+#define NO_MOVIE "-"
+
+
+/**
+ * @brief results line field of a recommendation
+ * @param movie: recommended movie, empty for none
+ * @return the movie or NO_MOVIE
+ */
+static string field(const string& movie)
+{
+    return movie.empty() ? NO_MOVIE : movie;
+}
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 4)
+    {
+        std::cerr << USAGE << std::endl;
+        return EXIT_FAILURE;
+    }
+    RecommenderSystem recommender;
+    if (recommender.loadData(argv[1], argv[2]) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+    vector<std::pair<string, string>> content = recommender.recommendAllByContent();
+    vector<std::pair<string, string>> cf = recommender.recommendAllByCF(VALIDATION_K);
+
+    std::ofstream results(argv[3]);
+    for (size_t user = 0; user < content.size(); user++)
+    {
+        results << content[user].first << " " << field(content[user].second) << " " << field(cf[user].second) << "\n";
+    }
+    results.close();
+    if (results.fail())
+    {
+        std::cerr << "Failed to write " << argv[3] << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << REAL_NAME << ": " << content.size() << " users written to " << argv[3] << std::endl;
+    if (argc < 5)
+    {
+        return EXIT_SUCCESS;
+    }
+
+    // compare user by user, the reference may come from a build with another Real type
+    std::ifstream reference(argv[4]);
+    if (!reference.is_open())
+    {
+        std::cerr << "Unable to open file " << argv[4] << std::endl;
+        return EXIT_FAILURE;
+    }
+    size_t compared = 0;
+    size_t contentChanged = 0;
+    size_t cfChanged = 0;
+    string line;
+    for (size_t user = 0; (user < content.size()) && std::getline(reference, line); user++)
+    {
+        std::istringstream fields(line);
+        string name, referenceContent, referenceCF;
+        if (!(fields >> name >> referenceContent >> referenceCF) || (name != content[user].first))
+        {
+            std::cerr << "Reference " << argv[4] << " doesn't match the data at line " << user + 1 << std::endl;
+            return EXIT_FAILURE;
+        }
+        compared++;
+        contentChanged += (referenceContent != field(content[user].second));
+        cfChanged += (referenceCF != field(cf[user].second));
+    }
+    if (compared != content.size())
+    {
+        std::cerr << "Reference " << argv[4] << " has fewer users than the data" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "top-1 changed against " << argv[4] << ": recommendByContent " << contentChanged << " of "
+              << compared << ", recommendByCF (k = " << VALIDATION_K << ") " << cfChanged << " of " << compared
+              << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,128 @@
+/**
+ * @file PreferenceCache.cpp
+ * @author  Jonathan Birnbaum
+ * @date 18/06/2020
+ *
+ * @brief PreferenceCache class implementation
+ */
+
+#include "PreferenceCache.h"
+#include <algorithm>
+
+
+/**
+ * @brief allocate empty slots
+ */
+void PreferenceCache::allocate(const int numberUsers)
+{
+    _numberUsers = numberUsers;
+    _capacity = numberUsers;
+    _vectors.assign((size_t)numberUsers * _numberFeatures, 0);
+    _norms.assign(numberUsers, 0);
+    _states.reset(new std::atomic<unsigned char>[numberUsers]);
+    for (int userId = 0; userId < numberUsers; userId++)
+    {
+        _states[userId].store(Empty, std::memory_order_relaxed);
+    }
+}
+
+
+/**
+ * @brief copy constructor
+ */
+PreferenceCache::PreferenceCache(const PreferenceCache& other) : _numberUsers(0), _capacity(0), _numberFeatures(0)
+{
+    *this = other;
+}
+
+
+/**
+ * @brief copy assignment
+ */
+PreferenceCache& PreferenceCache::operator=(const PreferenceCache& other)
+{
+    if (this != &other)
+    {
+        _numberFeatures = other._numberFeatures;
+        allocate(other._numberUsers);
+        _vectors = other._vectors;
+        _norms = other._norms;
+        for (int userId = 0; userId < _numberUsers; userId++)
+        {
+            unsigned char state = other._states[userId].load(std::memory_order_acquire);
+            _states[userId].store((state == Ready) ? Ready : Empty, std::memory_order_relaxed);
+        }
+    }
+    return *this;
+}
+
+
+/**
+ * @brief empty every slot
+ */
+void PreferenceCache::reset(const int numberUsers, const int numberFeatures)
+{
+    _numberFeatures = numberFeatures;
+    allocate(numberUsers);
+}
+
+
+/**
+ * @brief append an empty slot
+ */
+void PreferenceCache::addUser()
+{
+    // the atomics can't move, so a full array is copied into one twice as large
+    if (_numberUsers == _capacity)
+    {
+        _capacity = std::max(1, 2 * _capacity);
+        std::unique_ptr<std::atomic<unsigned char>[]> states(new std::atomic<unsigned char>[_capacity]);
+        for (int userId = 0; userId < _numberUsers; userId++)
+        {
+            states[userId].store(_states[userId].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        _states = std::move(states);
+    }
+    _states[_numberUsers].store(Empty, std::memory_order_relaxed);
+    _numberUsers++;
+    _vectors.resize((size_t)_numberUsers * _numberFeatures, 0);
+    _norms.resize(_numberUsers, 0);
+}
+
+
+/**
+ * @brief look a published vector up
+ */
+const Real* PreferenceCache::find(const int userId, Real& norm) const
+{
+    if (_states[userId].load(std::memory_order_acquire) != Ready)
+    {
+        return nullptr;
+    }
+    norm = _norms[userId];
+    return _vectors.data() + ((size_t)userId * _numberFeatures);
+}
+
+
+/**
+ * @brief take an empty slot to fill
+ */
+Real* PreferenceCache::claim(const int userId) const
+{
+    unsigned char expected = Empty;
+    if (!_states[userId].compare_exchange_strong(expected, Busy, std::memory_order_acquire))
+    {
+        return nullptr;
+    }
+    return _vectors.data() + ((size_t)userId * _numberFeatures);
+}
+
+
+/**
+ * @brief make a claimed slot visible
+ */
+void PreferenceCache::publish(const int userId, const Real norm) const
+{
+    _norms[userId] = norm;
+    _states[userId].store(Ready, std::memory_order_release);
+}
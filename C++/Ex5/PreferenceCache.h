@@ -0,0 +1,119 @@
+/**
+* @file PreferenceCache.h
+* @author  Jonathan Birnbaum
+* @date 18/06/2020
+*
+* @brief PreferenceCache class declaration and documentation
+*/
+
+#ifndef EX5_PREFERENCECACHE_H
+#define EX5_PREFERENCECACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "Real.h"
+
+using std::vector;
+
+/**
+ * @brief per-user preference vectors and their norms, filled lazily by the first query of every user.
+ * Concurrent readers are safe: one reader claims an empty slot and publishes it, the others compute their own copy
+ * meanwhile. Changes (invalidate, addUser, reset) need exclusive access, like the ratings they follow
+ */
+class PreferenceCache
+{
+    private:
+        enum SlotState : unsigned char
+        {
+            Empty,
+            Busy, // claimed by a reader that is computing it
+            Ready
+        };
+
+        int                                             _numberUsers;
+        int                                             _capacity; // allocated states, grown by doubling
+        int                                             _numberFeatures;
+        mutable vector<Real>                            _vectors; // row-major (user, feature), filled by readers
+        mutable vector<Real>                            _norms;
+        std::unique_ptr<std::atomic<unsigned char>[]>   _states;
+
+        /**
+         * @brief allocate empty slots
+         * @param numberUsers: number of users
+         */
+        void allocate(int numberUsers);
+
+    public:
+
+        /**
+         * @brief constructor - no users
+         */
+        PreferenceCache() : _numberUsers(0), _capacity(0), _numberFeatures(0) {}
+
+        /**
+         * @brief copy constructor - slots being computed are copied as empty
+         * @param other: cache to copy
+         */
+        PreferenceCache(const PreferenceCache& other);
+
+        /**
+         * @brief move constructor
+         */
+        PreferenceCache(PreferenceCache&& other) = default;
+
+        /**
+         * @brief copy assignment
+         * @param other: cache to copy
+         * @return this cache
+         */
+        PreferenceCache& operator=(const PreferenceCache& other);
+
+        /**
+         * @brief move assignment
+         */
+        PreferenceCache& operator=(PreferenceCache&& other) = default;
+
+        /**
+         * @brief empty every slot
+         * @param numberUsers: number of users
+         * @param numberFeatures: size of a preference vector
+         */
+        void reset(int numberUsers, int numberFeatures);
+
+        /**
+         * @brief append an empty slot for a new user
+         */
+        void addUser();
+
+        /**
+         * @brief forget a user's vector after the user's ratings changed
+         * @param userId: user id
+         */
+        void invalidate(const int userId) {_states[userId].store(Empty, std::memory_order_relaxed); }
+
+        /**
+         * @brief look a published vector up
+         * @param userId: user id
+         * @param norm: filled with the vector norm if found
+         * @return the vector, nullptr if not computed yet
+         */
+        const Real* find(int userId, Real& norm) const;
+
+        /**
+         * @brief take an empty slot to fill
+         * @param userId: user id
+         * @return the slot to write the vector to, nullptr if another reader holds it or it is ready
+         */
+        Real* claim(int userId) const;
+
+        /**
+         * @brief make a claimed slot visible to every reader
+         * @param userId: user id
+         * @param norm: norm of the written vector
+         */
+        void publish(int userId, Real norm) const;
+};
+
+#endif //EX5_PREFERENCECACHE_H
@@ -0,0 +1,365 @@
+/**
+ * @file QueryServer.cpp
+ * @author  Jonathan Birnbaum
+ * @date 18/06/2020
+ *
+ * @brief QueryServer class implementation
+ */
+
+#include "QueryServer.h"
+#include "UnixSocket.h"
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#define LATENCY_SAMPLES (4096)
+#define LATENCY_PERCENTILE (0.99)
+#define STATS_FORMAT "queries=%lu qps=%.1f hit_rate=%.3f p99_ms=%.3f coalesced=%lu"
+#define STATS_BUFFER_SIZE (256)
+
+
+/**
+ * @brief cache key of a read
+ * @param query: parsed read
+ * @return key unique per (mode, user, k, movie)
+ */
+static string cacheKey(const Query& query)
+{
+    return std::to_string((int)query.mode) + '\t' + query.user + '\t' + std::to_string(query.k) + '\t' +
+           query.movie;
+}
+
+
+/**
+ * @brief constructor
+ * @param recommender: system to serve
+ * @param capacity: replies kept in the cache
+ */
+QueryServer::QueryServer(RecommenderSystem& recommender, const size_t capacity) :
+        _recommender(recommender), _capacity(capacity), _nextLatency(0), _queries(0), _reads(0),
+        _cacheHits(0), _coalesced(0), _start(std::chrono::steady_clock::now()), _listener(-1)
+{
+    pthread_rwlockattr_t attributes;
+    pthread_rwlockattr_init(&attributes);
+#ifdef __GLIBC__
+    // a steady stream of reads must not starve the updates
+    pthread_rwlockattr_setkind_np(&attributes, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+    pthread_rwlock_init(&_dataLock, &attributes);
+    pthread_rwlockattr_destroy(&attributes);
+}
+
+
+/**
+ * @brief destructor
+ */
+QueryServer::~QueryServer()
+{
+    stop();
+    pthread_rwlock_destroy(&_dataLock);
+}
+
+
+/**
+ * @brief answer one line
+ * @param line: query line
+ * @return reply line
+ */
+string QueryServer::handle(const string& line)
+{
+    if (line == STATS_COMMAND)
+    {
+        ServerStats current = stats();
+        char buffer[STATS_BUFFER_SIZE];
+        snprintf(buffer, sizeof(buffer), STATS_FORMAT, current.queries, current.qps, current.hitRate,
+                 current.p99Ms, current.coalesced);
+        return buffer;
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Query query;
+    string reply;
+    try
+    {
+        reply = !parseQuery(line, query) ? QUERY_INVALID_REPLY : isUpdate(query) ? update(query) : read(query);
+    }
+    catch (const std::exception&)
+    {
+        reply = QUERY_FAILED_REPLY;
+    }
+    _queries++;
+    recordLatency(start);
+    return reply;
+}
+
+
+/**
+ * @brief answer a read through the cache and the in-flight table
+ * @param query: parsed read
+ * @return reply line
+ */
+string QueryServer::read(const Query& query)
+{
+    _reads++;
+    string key = cacheKey(query);
+    std::promise<string> promise;
+    std::unique_lock<std::mutex> lock(_cacheLock);
+    auto entry = _entries.find(key);
+    if (entry != _entries.end())
+    {
+        _cacheHits++;
+        _lru.splice(_lru.begin(), _lru, entry->second);
+        return entry->second->reply;
+    }
+    auto pending = _inFlight.find(key);
+    if (pending != _inFlight.end())
+    {
+        std::shared_future<string> reply = pending->second;
+        _coalesced++;
+        lock.unlock();
+        return reply.get();
+    }
+    _inFlight[key] = promise.get_future().share();
+    lock.unlock();
+
+    // the reply is stored before the read lock is released, so an update can't slip in between and leave it stale.
+    // A failure reaches the reads waiting for this one, and the next identical read computes it again
+    pthread_rwlock_rdlock(&_dataLock);
+    string reply;
+    std::exception_ptr failure;
+    try
+    {
+        reply = answerQuery(_recommender, query);
+        lock.lock();
+        store(key, query.user, reply);
+    }
+    catch (...)
+    {
+        failure = std::current_exception();
+        if (!lock.owns_lock())
+        {
+            lock.lock();
+        }
+    }
+    _inFlight.erase(key);
+    lock.unlock();
+    pthread_rwlock_unlock(&_dataLock);
+    if (failure)
+    {
+        promise.set_exception(failure);
+        std::rethrow_exception(failure);
+    }
+    promise.set_value(reply);
+    return reply;
+}
+
+
+/**
+ * @brief apply an update and drop the replies it invalidates
+ * @param query: parsed update
+ * @return reply line
+ */
+string QueryServer::update(const Query& query)
+{
+    pthread_rwlock_wrlock(&_dataLock);
+    string reply;
+    std::exception_ptr failure;
+    try
+    {
+        reply = applyUpdate(_recommender, query);
+    }
+    catch (...)
+    {
+        failure = std::current_exception(); // the update may be partly applied, its user's replies still go
+    }
+    {
+        // replies depend on the ratings of their own user only
+        std::lock_guard<std::mutex> lock(_cacheLock);
+        auto keys = _userKeys.find(query.user);
+        if (keys != _userKeys.end())
+        {
+            for (const auto& _key : keys->second)
+            {
+                auto entry = _entries.find(_key);
+                _lru.erase(entry->second);
+                _entries.erase(entry);
+            }
+            _userKeys.erase(keys);
+        }
+    }
+    pthread_rwlock_unlock(&_dataLock);
+    if (failure)
+    {
+        std::rethrow_exception(failure);
+    }
+    return reply;
+}
+
+
+/**
+ * @brief store a computed reply
+ * @param key: cache key
+ * @param user: user of the query
+ * @param reply: reply line
+ */
+void QueryServer::store(const string& key, const string& user, const string& reply)
+{
+    if (_capacity == 0)
+    {
+        return;
+    }
+    if (_entries.size() == _capacity)
+    {
+        const CacheEntry& oldest = _lru.back();
+        auto keys = _userKeys.find(oldest.user);
+        keys->second.erase(oldest.key);
+        if (keys->second.empty())
+        {
+            _userKeys.erase(keys);
+        }
+        _entries.erase(oldest.key);
+        _lru.pop_back();
+    }
+    _lru.push_front(CacheEntry{key, user, reply});
+    _entries[key] = _lru.begin();
+    _userKeys[user].insert(key);
+}
+
+
+/**
+ * @brief record a query latency
+ * @param start: time the query arrived
+ */
+void QueryServer::recordLatency(const std::chrono::steady_clock::time_point start)
+{
+    std::chrono::duration<double, std::milli> latency = std::chrono::steady_clock::now() - start;
+    std::lock_guard<std::mutex> lock(_statsLock);
+    if (_latencies.size() < LATENCY_SAMPLES)
+    {
+        _latencies.push_back(latency.count());
+    }
+    else
+    {
+        _latencies[_nextLatency] = latency.count();
+    }
+    _nextLatency = (_nextLatency + 1) % LATENCY_SAMPLES;
+}
+
+
+/**
+ * @brief getter counters
+ * @return current statistics
+ */
+ServerStats QueryServer::stats()
+{
+    ServerStats current{};
+    current.queries = _queries;
+    current.cacheHits = _cacheHits;
+    current.coalesced = _coalesced;
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - _start;
+    current.qps = (elapsed.count() > 0) ? current.queries / elapsed.count() : 0;
+    unsigned long reads = _reads;
+    current.hitRate = (reads > 0) ? (double)current.cacheHits / reads : 0;
+    vector<double> latencies;
+    {
+        std::lock_guard<std::mutex> lock(_statsLock);
+        latencies = _latencies;
+    }
+    if (!latencies.empty())
+    {
+        auto percentile = latencies.begin() + (size_t)(LATENCY_PERCENTILE * (latencies.size() - 1));
+        std::nth_element(latencies.begin(), percentile, latencies.end());
+        current.p99Ms = *percentile;
+    }
+    return current;
+}
+
+
+/**
+ * @brief answer the lines of one connection
+ * @param fd: connected descriptor
+ */
+void QueryServer::serveConnection(const int fd)
+{
+    LineReader reader(fd);
+    string line;
+    while (reader.readLine(line) && writeLine(fd, handle(line)))
+    {
+    }
+    // the last use of the server: serve may return once the lock is released
+    std::lock_guard<std::mutex> lock(_connectionsLock);
+    _connections.erase(fd);
+    close(fd);
+    _connectionsDone.notify_all();
+}
+
+
+/**
+ * @brief listen on a socket and answer every connection until stop
+ * @param socketPath: socket file path
+ * @return false if the socket could not be opened
+ */
+bool QueryServer::serve(const string& socketPath)
+{
+    int listener = listenUnixSocket(socketPath);
+    if (listener < 0)
+    {
+        return false;
+    }
+    _listener = listener;
+    while (_listener >= 0)
+    {
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0)
+        {
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(_connectionsLock);
+        if (_listener < 0)
+        {
+            close(fd);
+            break;
+        }
+        // detached, so finished connections leave nothing behind; serve waits for the open ones below
+        _connections.insert(fd);
+        try
+        {
+            std::thread(&QueryServer::serveConnection, this, fd).detach();
+        }
+        catch (const std::system_error&)
+        {
+            _connections.erase(fd);
+            close(fd);
+        }
+    }
+    {
+        std::unique_lock<std::mutex> lock(_connectionsLock);
+        _connectionsDone.wait(lock, [this]() {return _connections.empty(); });
+    }
+    close(listener);
+    unlink(socketPath.c_str());
+    return true;
+}
+
+
+/**
+ * @brief make serve return
+ */
+void QueryServer::stop()
+{
+    int listener = _listener.exchange(-1);
+    if (listener < 0)
+    {
+        return;
+    }
+    // shutdown wakes the blocked accept and reads without closing descriptors still in use
+    shutdown(listener, SHUT_RDWR);
+    std::lock_guard<std::mutex> lock(_connectionsLock);
+    for (int _fd : _connections)
+    {
+        shutdown(_fd, SHUT_RDWR);
+    }
+}
@@ -0,0 +1,166 @@
+/**
+* @file QueryServer.h
+* @author  Jonathan Birnbaum
+* @date 18/06/2020
+*
+* @brief QueryServer class declaration and documentation
+*/
+
+#ifndef EX5_QUERYSERVER_H
+#define EX5_QUERYSERVER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <future>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <pthread.h>
+#include "RecommenderQuery.h"
+#include "RecommenderSystem.h"
+
+using std::string;
+using std::unordered_map;
+using std::vector;
+
+#define STATS_COMMAND "stats"
+#define QUERY_FAILED_REPLY "ERROR"
+
+/**
+ * @brief counters of a QueryServer
+ */
+typedef struct ServerStats
+{
+    unsigned long   queries; // reads and updates answered
+    unsigned long   cacheHits; // reads answered from the result cache
+    unsigned long   coalesced; // reads that waited for an identical read in flight
+    double          qps; // queries per second since the start
+    double          hitRate; // cacheHits / reads
+    double          p99Ms; // 99th percentile latency of the recent queries, in milliseconds
+} ServerStats;
+
+/**
+ * @brief local query server around a RecommenderSystem: reads run concurrently, identical reads in flight are
+ * computed once, and their replies are kept in a bounded LRU cache keyed by (mode, user, k, movie). An update
+ * takes exclusive access and drops the cached replies of its user, the only ones it can change
+ */
+class QueryServer
+{
+    private:
+        /**
+         * @brief a cached reply
+         */
+        typedef struct CacheEntry
+        {
+            string  key;
+            string  user;
+            string  reply;
+        } CacheEntry;
+
+        RecommenderSystem&                                      _recommender;
+        pthread_rwlock_t                                        _dataLock; // reads shared, updates exclusive
+        std::mutex                                              _cacheLock; // guards every member below it
+        size_t                                                  _capacity;
+        std::list<CacheEntry>                                   _lru; // most recently used first
+        unordered_map<string, std::list<CacheEntry>::iterator>  _entries; // key -> entry
+        unordered_map<string, std::unordered_set<string>>       _userKeys; // user -> cached keys
+        unordered_map<string, std::shared_future<string>>       _inFlight; // key -> reply being computed
+        std::mutex                                              _statsLock; // guards the latency samples
+        vector<double>                                          _latencies; // ring of recent latencies in ms
+        size_t                                                  _nextLatency;
+        std::atomic<unsigned long>                              _queries;
+        std::atomic<unsigned long>                              _reads;
+        std::atomic<unsigned long>                              _cacheHits;
+        std::atomic<unsigned long>                              _coalesced;
+        std::chrono::steady_clock::time_point                   _start;
+        std::atomic<int>                                        _listener;
+        std::mutex                                              _connectionsLock;
+        std::unordered_set<int>                                 _connections; // open descriptors, closed by stop
+        std::condition_variable                                 _connectionsDone; // a connection was closed
+
+        /**
+         * @brief answer a read through the cache and the in-flight table
+         * @param query: parsed read
+         * @return reply line
+         * @throw what computing the reply threw, also to the identical reads waiting for it
+         */
+        string read(const Query& query);
+
+        /**
+         * @brief apply an update and drop the replies it invalidates
+         * @param query: parsed update
+         * @return reply line
+         * @throw what applying it threw, with the locks released and the user's replies dropped
+         */
+        string update(const Query& query);
+
+        /**
+         * @brief store a computed reply, evicting the least recently used one when full - cacheLock held
+         * @param key: cache key
+         * @param user: user of the query
+         * @param reply: reply line
+         */
+        void store(const string& key, const string& user, const string& reply);
+
+        /**
+         * @brief record a query latency
+         * @param start: time the query arrived
+         */
+        void recordLatency(std::chrono::steady_clock::time_point start);
+
+        /**
+         * @brief answer the lines of one connection, then close it
+         * @param fd: connected descriptor
+         */
+        void serveConnection(int fd);
+
+    public:
+
+        /**
+         * @brief constructor
+         * @param recommender: system to serve, only changed through this server while it runs
+         * @param capacity: replies kept in the cache, 0 disables it
+         */
+        explicit QueryServer(RecommenderSystem& recommender, size_t capacity);
+
+        QueryServer(const QueryServer&) = delete;
+        QueryServer& operator=(const QueryServer&) = delete;
+
+        /**
+         * @brief destructor
+         */
+        ~QueryServer();
+
+        /**
+         * @brief answer one line, safe to call from many threads
+         * @param line: query line (see RecommenderQuery.h) or "stats"
+         * @return reply line, QUERY_FAILED_REPLY if answering threw (out of memory)
+         */
+        string handle(const string& line);
+
+        /**
+         * @brief listen on a socket and answer every connection in its own thread until stop, then wait for the
+         * connection threads
+         * @param socketPath: socket file path
+         * @return false if the socket could not be opened
+         */
+        bool serve(const string& socketPath);
+
+        /**
+         * @brief make serve return, closing its connections - safe from any thread
+         */
+        void stop();
+
+        /**
+         * @brief getter counters
+         * @return current statistics
+         */
+        ServerStats stats();
+};
+
+#endif //EX5_QUERYSERVER_H
@@ -0,0 +1,161 @@
+/**
+ * @file RatingMatrix.cpp
+ * @author  Jonathan Birnbaum
+ * @date 18/06/2020
+ *
+ * @brief RatingMatrix class implementation
+ */
+
+#include "RatingMatrix.h"
+
+#define MIN_ROW_CAPACITY (4)
+
+
+/**
+ * @brief set the rows to their entries
+ */
+void RatingMatrix::assignRows(const size_t* rowStart, const int rows)
+{
+    _rowStart.resize(rows);
+    _rowSize.resize(rows);
+    _rowCapacity.resize(rows);
+    for (int row = 0; row < rows; row++)
+    {
+        _rowStart[row] = rowStart[row] - rowStart[0];
+        _rowSize[row] = (int)(rowStart[row + 1] - rowStart[row]);
+        _rowCapacity[row] = _rowSize[row];
+    }
+    _numberRatings = rowStart[rows] - rowStart[0];
+    _unused = 0;
+}
+
+
+/**
+ * @brief replace the content
+ */
+void RatingMatrix::assign(const size_t* rowStart, const int* movies, const Real* rates, const int rows)
+{
+    assignRows(rowStart, rows);
+    _movies.owned().assign(movies + rowStart[0], movies + rowStart[rows]);
+    _rates.owned().assign(rates + rowStart[0], rates + rowStart[rows]);
+}
+
+
+/**
+ * @brief replace the content by mapped entries
+ */
+void RatingMatrix::share(std::shared_ptr<const MappedFile> file, const size_t* rowStart, const int* movies,
+                         const Real* rates, const int rows)
+{
+    assignRows(rowStart, rows);
+    _movies.share(file, movies + rowStart[0], _numberRatings);
+    _rates.share(std::move(file), rates + rowStart[0], _numberRatings);
+}
+
+
+/**
+ * @brief append an empty row
+ */
+int RatingMatrix::addRow()
+{
+    _rowStart.push_back(_movies.size());
+    _rowSize.push_back(0);
+    _rowCapacity.push_back(0);
+    return numberRows() - 1;
+}
+
+
+/**
+ * @brief insert or update a rating
+ */
+bool RatingMatrix::setRate(const int row, const int movie, const Real rate)
+{
+    std::vector<int>& ownedMovies = _movies.owned();
+    std::vector<Real>& ownedRates = _rates.owned();
+    int* begin = ownedMovies.data() + _rowStart[row];
+    int position = (int)(std::lower_bound(begin, begin + _rowSize[row], movie) - begin);
+    if ((position < _rowSize[row]) && (begin[position] == movie))
+    {
+        ownedRates[_rowStart[row] + position] = rate;
+        return false;
+    }
+
+    if (_rowSize[row] == _rowCapacity[row])
+    {
+        // move the row to the end with twice the room, the old place is reclaimed by compact
+        size_t newStart = ownedMovies.size();
+        int newCapacity = std::max(MIN_ROW_CAPACITY, 2 * _rowCapacity[row]);
+        ownedMovies.resize(newStart + newCapacity);
+        ownedRates.resize(newStart + newCapacity);
+        std::copy(ownedMovies.begin() + _rowStart[row], ownedMovies.begin() + _rowStart[row] + _rowSize[row],
+                  ownedMovies.begin() + newStart);
+        std::copy(ownedRates.begin() + _rowStart[row], ownedRates.begin() + _rowStart[row] + _rowSize[row],
+                  ownedRates.begin() + newStart);
+        _unused += _rowCapacity[row];
+        _rowStart[row] = newStart;
+        _rowCapacity[row] = newCapacity;
+    }
+
+    size_t start = _rowStart[row];
+    std::copy_backward(ownedMovies.begin() + start + position, ownedMovies.begin() + start + _rowSize[row],
+                       ownedMovies.begin() + start + _rowSize[row] + 1);
+    std::copy_backward(ownedRates.begin() + start + position, ownedRates.begin() + start + _rowSize[row],
+                       ownedRates.begin() + start + _rowSize[row] + 1);
+    ownedMovies[start + position] = movie;
+    ownedRates[start + position] = rate;
+    _rowSize[row]++;
+    _numberRatings++;
+    if (_unused > ownedMovies.size() / 2)
+    {
+        compact();
+    }
+    return true;
+}
+
+
+/**
+ * @brief delete a rating
+ */
+bool RatingMatrix::removeRate(const int row, const int movie)
+{
+    const int* begin = movies(row);
+    const int* found = std::lower_bound(begin, begin + _rowSize[row], movie);
+    if ((found == begin + _rowSize[row]) || (*found != movie))
+    {
+        return false;
+    }
+    size_t start = _rowStart[row];
+    size_t position = start + (found - begin);
+    std::vector<int>& ownedMovies = _movies.owned();
+    std::vector<Real>& ownedRates = _rates.owned();
+    std::copy(ownedMovies.begin() + position + 1, ownedMovies.begin() + start + _rowSize[row],
+              ownedMovies.begin() + position);
+    std::copy(ownedRates.begin() + position + 1, ownedRates.begin() + start + _rowSize[row],
+              ownedRates.begin() + position);
+    _rowSize[row]--;
+    _numberRatings--;
+    return true;
+}
+
+
+/**
+ * @brief pack the rows back to back
+ */
+void RatingMatrix::compact()
+{
+    std::vector<int> packedMovies;
+    std::vector<Real> packedRates;
+    packedMovies.reserve(_numberRatings);
+    packedRates.reserve(_numberRatings);
+    for (int row = 0; row < numberRows(); row++)
+    {
+        size_t start = packedMovies.size();
+        packedMovies.insert(packedMovies.end(), movies(row), movies(row) + _rowSize[row]);
+        packedRates.insert(packedRates.end(), rates(row), rates(row) + _rowSize[row]);
+        _rowStart[row] = start;
+        _rowCapacity[row] = _rowSize[row];
+    }
+    _movies.owned().swap(packedMovies);
+    _rates.owned().swap(packedRates);
+    _unused = 0;
+}
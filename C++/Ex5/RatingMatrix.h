@@ -0,0 +1,164 @@
+/**
+* @file RatingMatrix.h
+* @author  Jonathan Birnbaum
+* @date 18/06/2020
+*
+* @brief RatingMatrix class declaration and documentation
+*/
+
+#ifndef EX5_RATINGMATRIX_H
+#define EX5_RATINGMATRIX_H
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "MappedFile.h"
+#include "Real.h"
+#include "SharedArray.h"
+
+/**
+ * @brief sparse (user, movie) ratings in compressed rows: every user row holds its rated movie ids in
+ * ascending order and the matching rates. Rows may keep spare capacity, so a new rating is inserted in place,
+ * and a full row moves to the end of the arrays. The entries may be read in place from a mapped snapshot until
+ * the first change
+ */
+class RatingMatrix
+{
+    private:
+        std::vector<size_t>     _rowStart; // offset of every row in _movies / _rates
+        std::vector<int>        _rowSize;
+        std::vector<int>        _rowCapacity;
+        SharedArray<int>        _movies;
+        SharedArray<Real>       _rates;
+        size_t                  _numberRatings;
+        size_t                  _unused; // entries of _movies left behind by moved rows
+
+        /**
+         * @brief pack the rows back to back without spare capacity
+         */
+        void compact();
+
+        /**
+         * @brief set the rows to their entries without spare capacity
+         * @param rowStart: rows + 1 offsets of every row's entries
+         * @param rows: number of rows
+         */
+        void assignRows(const size_t* rowStart, int rows);
+
+    public:
+
+        /**
+         * @brief constructor - no rows
+         */
+        RatingMatrix() : _numberRatings(0), _unused(0) {}
+
+        /**
+         * @brief replace the content
+         * @param rowStart: rows + 1 offsets of every row's entries
+         * @param movies: movie id of each entry, ascending within a row
+         * @param rates: rate of each entry
+         * @param rows: number of rows
+         */
+        void assign(const size_t* rowStart, const int* movies, const Real* rates, int rows);
+
+        /**
+         * @brief replace the content by entries read in place from a mapping
+         * @param file: mapping holding movies and rates
+         * @param rowStart: rows + 1 offsets of every row's entries
+         * @param movies: movie id of each entry, ascending within a row, inside the mapping
+         * @param rates: rate of each entry, inside the mapping
+         * @param rows: number of rows
+         */
+        void share(std::shared_ptr<const MappedFile> file, const size_t* rowStart, const int* movies,
+                   const Real* rates, int rows);
+
+        /**
+         * @brief getter number of rows
+         * @return number of users
+         */
+        int numberRows() const {return (int)_rowSize.size(); }
+
+        /**
+         * @brief getter number of entries
+         * @return number of ratings
+         */
+        size_t numberRatings() const {return _numberRatings; }
+
+        /**
+         * @brief getter row size
+         * @param row: user id
+         * @return number of movies the user rated
+         */
+        int rowSize(const int row) const {return _rowSize[row]; }
+
+        /**
+         * @brief getter row movies
+         * @param row: user id
+         * @return rowSize(row) ascending movie ids
+         */
+        const int* movies(const int row) const {return _movies.data() + _rowStart[row]; }
+
+        /**
+         * @brief getter row rates
+         * @param row: user id
+         * @return rowSize(row) rates matching movies(row)
+         */
+        const Real* rates(const int row) const {return _rates.data() + _rowStart[row]; }
+
+        /**
+         * @brief look a rating up by binary search
+         * @param row: user id
+         * @param movie: movie id
+         * @param rate: filled with the rate if found
+         * @return true if the user rated the movie
+         */
+        bool findRate(const int row, const int movie, Real& rate) const
+        {
+            const int* begin = movies(row);
+            const int* end = begin + rowSize(row);
+            const int* found = std::lower_bound(begin, end, movie);
+            if ((found == end) || (*found != movie))
+            {
+                return false;
+            }
+            rate = rates(row)[found - begin];
+            return true;
+        }
+
+        /**
+         * @brief append an empty row
+         * @return the new row index
+         */
+        int addRow();
+
+        /**
+         * @brief insert or update a rating, keeping the row sorted
+         * @param row: user id
+         * @param movie: movie id
+         * @param rate: user rate
+         * @return true if the rating is new, false if an existing rate was updated
+         */
+        bool setRate(int row, int movie, Real rate);
+
+        /**
+         * @brief delete a rating
+         * @param row: user id
+         * @param movie: movie id
+         * @return true if the user had rated the movie
+         */
+        bool removeRate(int row, int movie);
+
+        /**
+         * @brief getter memory footprint
+         * @return bytes held by the rows, without entries read from a mapping
+         */
+        size_t memoryBytes() const
+        {
+            return (_rowStart.capacity() * sizeof(size_t)) +
+                   ((_rowSize.capacity() + _rowCapacity.capacity()) * sizeof(int)) + _movies.ownedBytes() +
+                   _rates.ownedBytes();
+        }
+};
+
+#endif //EX5_RATINGMATRIX_H
@@ -0,0 +1,24 @@
+/**
+* @file Real.h
+* @author  Jonathan Birnbaum
+* @date 18/06/2020
+*
+* @brief floating point type of the stored features, norms, rates and similarities
+*/
+
+#ifndef EX5_REAL_H
+#define EX5_REAL_H
+
+/**
+ * RECOMMENDER_FLOAT32 (cmake -DEX5_FLOAT32=ON) stores and computes them in float: half the memory and twice the
+ * values per SIMD register. Features and rates are small integers, so only the similarities round differently
+ */
+#ifdef RECOMMENDER_FLOAT32
+typedef float Real;
+#define REAL_NAME "float32"
+#else
+typedef double Real;
+#define REAL_NAME "float64"
+#endif
+
+#endif //EX5_REAL_H
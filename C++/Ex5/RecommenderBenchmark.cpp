@@ -0,0 +1,251 @@
+/**
+ * @file RecommenderBenchmark.cpp
+ * @author  Jonathan Birnbaum
+ * @date 18/06/2020
+ *
+ * @brief benchmark of the batch recommendation APIs: scaling with the number of threads, and the accuracy of the
+ * CF engines on held-out ratings
+ */
+
+#include "BenchmarkData.h"
+#include "RecommenderSystem.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <thread>
+
+#define DEFAULT_MOVIES (2000)
+#define DEFAULT_USERS (2000)
+#define DEFAULT_FEATURES (20)
+#define DEFAULT_NA_FRACTION (0.95)
+#define DEFAULT_K (10)
+#define MAX_THREADS (64)
+#define FEATURES_PATH "benchmark_features.txt"
+#define RANKS_PATH "benchmark_ranks.txt"
+#define HOLDOUT_RANKS_PATH "benchmark_ranks_holdout.txt"
+#define HOLDOUT_FRACTION (0.1)
+#define HOLDOUT_SEED (1)
+#define NA_RATE "NA"
+
+
+/**
+ * @brief a rating hidden from the evaluated system
+ */
+typedef struct HeldOutRating
+{
+    string userName, movieName;
+    double rate;
+} HeldOutRating;
+
+
+/**
+ * @brief time a batch call for growing thread counts and check the results don't change
+ * @param name: printed name
+ * @param batch: callable taking the number of threads and returning the results table
+ */
+template <class Batch>
+static void benchmarkScaling(const char* name, Batch batch)
+{
+    int maxThreads = std::min(MAX_THREADS, std::max(1, (int)std::thread::hardware_concurrency()));
+    double singleThread = 0;
+    vector<std::pair<string, string>> expected;
+    vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2)
+    {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    printf("%s\n%8s %12s %8s %10s\n", name, "threads", "time[s]", "speedup", "efficiency");
+    for (int threads : threadCounts)
+    {
+        auto start = std::chrono::steady_clock::now();
+        vector<std::pair<string, string>> results = batch(threads);
+        std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+        if (threads == 1)
+        {
+            singleThread = time.count();
+            expected = results;
+        }
+        else if (results != expected)
+        {
+            printf("results differ with %d threads\n", threads);
+        }
+        double speedup = singleThread / time.count();
+        printf("%8d %12.3f %8.2f %9.0f%%\n", threads, time.count(), speedup, 100 * speedup / threads);
+    }
+}
+
+
+/**
+ * @brief copy a rank file with a random fraction of the ratings replaced by NA. The first rated movie of every
+ * user stays, so every user keeps a rating to predict from
+ * @param ranksPath: rank file to read
+ * @param holdoutPath: rank file to write
+ * @param heldOut: filled with the hidden ratings
+ * @param trainMean: filled with the mean of the ratings left
+ * @return true for success
+ */
+static bool writeHoldout(const string& ranksPath, const string& holdoutPath, vector<HeldOutRating>& heldOut,
+                         double& trainMean)
+{
+    std::ifstream ranks(ranksPath);
+    std::ofstream holdout(holdoutPath);
+    string line;
+    if (!std::getline(ranks, line))
+    {
+        return false;
+    }
+    holdout << line << "\n";
+    vector<string> movieNames;
+    std::istringstream header(line);
+    for (string movieName; header >> movieName;)
+    {
+        movieNames.push_back(movieName);
+    }
+
+    std::mt19937 generator(HOLDOUT_SEED);
+    std::uniform_real_distribution<double> unit(0, 1);
+    double trainSum = 0;
+    size_t trainCount = 0;
+    heldOut.clear();
+    while (std::getline(ranks, line))
+    {
+        std::istringstream row(line);
+        string userName;
+        row >> userName;
+        holdout << userName;
+        bool firstRate = true;
+        string rate;
+        for (size_t movie = 0; (movie < movieNames.size()) && (row >> rate); movie++)
+        {
+            if ((rate != NA_RATE) && !firstRate && (unit(generator) < HOLDOUT_FRACTION))
+            {
+                heldOut.push_back({userName, movieNames[movie], std::atof(rate.c_str())});
+                rate = NA_RATE;
+            }
+            else if (rate != NA_RATE)
+            {
+                firstRate = false;
+                trainSum += std::atof(rate.c_str());
+                trainCount++;
+            }
+            holdout << " " << rate;
+        }
+        holdout << "\n";
+    }
+    trainMean = trainSum / std::max((size_t)1, trainCount);
+    holdout.close();
+    return !holdout.fail();
+}
+
+
+/**
+ * @brief root mean square error of a predictor on the held-out ratings
+ * @param heldOut: hidden ratings
+ * @param predict: callable taking a held-out rating and returning the predicted rate
+ * @param unpredicted: filled with the number of ratings without a finite prediction (left out of the error)
+ * @return RMSE
+ */
+template <class Predict>
+static double heldOutRmse(const vector<HeldOutRating>& heldOut, Predict predict, int& unpredicted)
+{
+    double squaredSum = 0;
+    size_t count = 0;
+    unpredicted = 0;
+    for (const auto& _rating : heldOut)
+    {
+        double predicted = predict(_rating);
+        if (!std::isfinite(predicted))
+        {
+            unpredicted++;
+            continue;
+        }
+        squaredSum += (predicted - _rating.rate) * (predicted - _rating.rate);
+        count++;
+    }
+    return std::sqrt(squaredSum / std::max((size_t)1, count));
+}
+
+
+/**
+ * @brief compare the item-item and factor model CF predictions on ratings the system didn't see
+ * @param k: neighbours of the item-item CF
+ * @return true for success
+ */
+static bool evaluateHoldout(const int k)
+{
+    vector<HeldOutRating> heldOut;
+    double trainMean = 0;
+    RecommenderSystem recommender;
+    if (!writeHoldout(RANKS_PATH, HOLDOUT_RANKS_PATH, heldOut, trainMean) ||
+        (recommender.loadData(FEATURES_PATH, HOLDOUT_RANKS_PATH) != 0))
+    {
+        return false;
+    }
+    recommender.buildFactorModel();
+
+    printf("held-out ratings: %zu (%.0f%%)\n%-16s %10s %12s\n", heldOut.size(), 100 * HOLDOUT_FRACTION, "predictor",
+           "RMSE", "unpredicted");
+    int unpredicted = 0;
+    double rmse = heldOutRmse(heldOut, [&](const HeldOutRating&) {return trainMean; }, unpredicted);
+    printf("%-16s %10.4f %12d\n", "training mean", rmse, unpredicted);
+    rmse = heldOutRmse(heldOut, [&](const HeldOutRating& rating)
+    {
+        return recommender.predictMovieScoreForUser(rating.movieName, rating.userName, k);
+    }, unpredicted);
+    printf("%-16s %10.4f %12d\n", "item-item CF", rmse, unpredicted);
+    rmse = heldOutRmse(heldOut, [&](const HeldOutRating& rating)
+    {
+        return recommender.predictByFactors(rating.movieName, rating.userName);
+    }, unpredicted);
+    printf("%-16s %10.4f %12d\n", "ALS factors", rmse, unpredicted);
+    return true;
+}
+
+
+int main(int argc, char* argv[])
+{
+    int movies = (argc > 1) ? std::atoi(argv[1]) : DEFAULT_MOVIES;
+    int users = (argc > 2) ? std::atoi(argv[2]) : DEFAULT_USERS;
+    int features = (argc > 3) ? std::atoi(argv[3]) : DEFAULT_FEATURES;
+    double naFraction = (argc > 4) ? std::atof(argv[4]) : DEFAULT_NA_FRACTION;
+    int k = DEFAULT_K;
+
+    RecommenderSystem recommender;
+    if (!writeBenchmarkData(FEATURES_PATH, RANKS_PATH, movies, users, features, naFraction) ||
+        (recommender.loadData(FEATURES_PATH, RANKS_PATH) != 0))
+    {
+        return EXIT_FAILURE;
+    }
+    printf("%d movies, %d users, %d features, %.2f NA\n", movies, users, features, naFraction);
+
+    benchmarkScaling("recommendAllByContent", [&](int threads)
+    {
+        return recommender.recommendAllByContent(threads);
+    });
+    benchmarkScaling("recommendAllByCF", [&](int threads)
+    {
+        return recommender.recommendAllByCF(k, threads);
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    recommender.buildFactorModel();
+    std::chrono::duration<double> trainTime = std::chrono::steady_clock::now() - start;
+    printf("buildFactorModel %.3f s\n", trainTime.count());
+    benchmarkScaling("recommendAllByFactors", [&](int threads)
+    {
+        return recommender.recommendAllByFactors(threads);
+    });
+
+    // a separate system, so the hidden ratings don't change the timed one
+    if (!evaluateHoldout(k))
+    {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
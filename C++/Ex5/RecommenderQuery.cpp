@@ -0,0 +1,105 @@
+/**
+ * @file RecommenderQuery.cpp
+ * @author  Jonathan Birnbaum
+ * @date 18/06/2020
+ *
+ * @brief text queries to a RecommenderSystem
+ */
+
+#include "RecommenderQuery.h"
+#include <sstream>
+
+#define CONTENT_COMMAND "content"
+#define CF_COMMAND "cf"
+#define PREDICT_COMMAND "predict"
+#define RATE_COMMAND "rate"
+#define UNRATE_COMMAND "unrate"
+
+
+/**
+ * @brief parse a query line
+ * @param line: query line
+ * @param query: filled with the query
+ * @return false if invalid
+ */
+bool parseQuery(const string& line, Query& query)
+{
+    std::istringstream words(line);
+    string command;
+    string extra;
+    if (!(words >> command >> query.user))
+    {
+        return false;
+    }
+    query.movie.clear();
+    query.k = 0;
+    query.rate = 0;
+    if (command == CONTENT_COMMAND)
+    {
+        query.mode = ContentQuery;
+    }
+    else if ((command == CF_COMMAND) && (words >> query.k))
+    {
+        query.mode = CFQuery;
+    }
+    else if ((command == PREDICT_COMMAND) && (words >> query.movie >> query.k))
+    {
+        query.mode = PredictQuery;
+    }
+    else if ((command == RATE_COMMAND) && (words >> query.movie >> query.rate))
+    {
+        query.mode = RateQuery;
+    }
+    else if ((command == UNRATE_COMMAND) && (words >> query.movie))
+    {
+        query.mode = UnrateQuery;
+    }
+    else
+    {
+        return false;
+    }
+    return !(words >> extra) && (query.k >= 0);
+}
+
+
+/**
+ * @brief answer a query
+ * @param recommender: system to ask
+ * @param query: parsed query
+ * @return reply line
+ */
+string answerQuery(const RecommenderSystem& recommender, const Query& query)
+{
+    switch (query.mode)
+    {
+        case ContentQuery:
+            return recommender.recommendByContent(query.user);
+        case CFQuery:
+            return recommender.recommendByCF(query.user, query.k);
+        case PredictQuery:
+            return std::to_string(recommender.predictMovieScoreForUser(query.movie, query.user, query.k));
+        default:
+            return QUERY_INVALID_REPLY;
+    }
+}
+
+
+/**
+ * @brief apply an update query
+ * @param recommender: system to change
+ * @param query: parsed update
+ * @return reply line
+ */
+string applyUpdate(RecommenderSystem& recommender, const Query& query)
+{
+    switch (query.mode)
+    {
+        case RateQuery:
+            return recommender.addRating(query.user, query.movie, query.rate) ? UPDATE_DONE_REPLY
+                                                                              : UPDATE_FAILED_REPLY;
+        case UnrateQuery:
+            return recommender.removeRating(query.user, query.movie) ? UPDATE_DONE_REPLY : UPDATE_FAILED_REPLY;
+        default:
+            return QUERY_INVALID_REPLY;
+    }
+}
@@ -0,0 +1,75 @@
+/**
+* @file RecommenderQuery.h
+* @author  Jonathan Birnbaum
+* @date 18/06/2020
+*
+* @brief text queries to a RecommenderSystem, one line per query and per reply:
+* "content <user>", "cf <user> <k>" and "predict <user> <movie> <k>", and the updates "rate <user> <movie> <rate>"
+* and "unrate <user> <movie>"
+*/
+
+#ifndef EX5_RECOMMENDERQUERY_H
+#define EX5_RECOMMENDERQUERY_H
+
+#include <string>
+#include "RecommenderSystem.h"
+
+using std::string;
+
+#define QUERY_INVALID_REPLY "INVALID QUERY"
+#define UPDATE_DONE_REPLY "OK"
+#define UPDATE_FAILED_REPLY "FAILED"
+
+/**
+ * @brief kinds of query
+ */
+enum QueryMode
+{
+    ContentQuery, CFQuery, PredictQuery, RateQuery, UnrateQuery
+};
+
+/**
+ * @brief a parsed query
+ */
+typedef struct Query
+{
+    QueryMode   mode;
+    string      user;
+    string      movie; // PredictQuery, RateQuery and UnrateQuery only
+    int         k; // CFQuery and PredictQuery only
+    double      rate; // RateQuery only
+} Query;
+
+/**
+ * @brief parse a query line
+ * @param line: query line
+ * @param query: filled with the query
+ * @return false if the line is not a valid query
+ */
+bool parseQuery(const string& line, Query& query);
+
+/**
+ * @brief check if a query changes the ratings
+ * @param query: parsed query
+ * @return true for RateQuery and UnrateQuery
+ */
+inline bool isUpdate(const Query& query) {return (query.mode == RateQuery) || (query.mode == UnrateQuery); }
+
+/**
+ * @brief answer a query that doesn't change the ratings
+ * @param recommender: system to ask
+ * @param query: parsed query
+ * @return reply line: a movie name or a predicted rate, or the system's error message (QUERY_INVALID_REPLY for
+ * an update)
+ */
+string answerQuery(const RecommenderSystem& recommender, const Query& query);
+
+/**
+ * @brief apply an update query
+ * @param recommender: system to change
+ * @param query: parsed update
+ * @return UPDATE_DONE_REPLY, UPDATE_FAILED_REPLY if the system refused it or QUERY_INVALID_REPLY for a read
+ */
+string applyUpdate(RecommenderSystem& recommender, const Query& query);
+
+#endif //EX5_RECOMMENDERQUERY_H
@@ -0,0 +1,37 @@
+/**
+ * @file RecommenderRouter.cpp
+ * @author  Jonathan Birnbaum
+ * @date 18/06/2020
+ *
+ * @brief sharded recommender: starts the shard workers of a snapshot, then forwards the query lines of the
+ * standard input and prints the replies
+ */
+
+#include "ShardRouter.h"
+#include <cstdlib>
+#include <iostream>
+
+#define USAGE "Usage: RecommenderRouter <snapshot> <shards> [socket directory]"
+#define DEFAULT_SOCKET_DIRECTORY "/tmp"
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        std::cerr << USAGE << std::endl;
+        return EXIT_FAILURE;
+    }
+    ShardRouter router;
+    if (!router.start(argv[1], std::atoi(argv[2]), (argc > 3) ? argv[3] : DEFAULT_SOCKET_DIRECTORY))
+    {
+        std::cerr << "Failed to start the shards of " << argv[1] << std::endl;
+        return EXIT_FAILURE;
+    }
+    string line;
+    while (std::getline(std::cin, line))
+    {
+        std::cout << router.query(line) << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
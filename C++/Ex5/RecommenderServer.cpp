@@ -0,0 +1,38 @@
+/**
+ * @file RecommenderServer.cpp
+ * @author  Jonathan Birnbaum
+ * @date 18/06/2020
+ *
+ * @brief recommender query server: loads a snapshot and answers query lines on a Unix socket, "stats" reports
+ * the qps, cache hit rate and p99 latency
+ */
+
+#include "QueryServer.h"
+#include <cstdlib>
+#include <iostream>
+
+#define USAGE "Usage: RecommenderServer <snapshot> <socket> [cache capacity]"
+#define DEFAULT_CACHE_CAPACITY (100000)
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        std::cerr << USAGE << std::endl;
+        return EXIT_FAILURE;
+    }
+    RecommenderSystem recommender;
+    if (!recommender.loadSnapshot(argv[1]))
+    {
+        std::cerr << "Failed to load " << argv[1] << std::endl;
+        return EXIT_FAILURE;
+    }
+    QueryServer server(recommender, (argc > 3) ? std::strtoul(argv[3], nullptr, 10) : DEFAULT_CACHE_CAPACITY);
+    if (!server.serve(argv[2]))
+    {
+        std::cerr << "Failed to listen on " << argv[2] << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
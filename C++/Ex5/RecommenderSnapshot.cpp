@@ -0,0 +1,298 @@
+/**
+ * @file RecommenderSnapshot.cpp
+ * @author  Jonathan Birnbaum
+ * @date 18/06/2020
+ *
+ * @brief RecommenderSystem binary snapshots
+ *
+ * layout: a SnapshotHeader, then every section at the 8-aligned file offset the header gives:
+ * movie name offsets (uint64, numberMovies + 1) and characters, user name offsets (uint64, numberUsers + 1) and
+ * characters, features (Real, numberMovies * numberFeatures), norms (Real, numberMovies), unit features
+ * (Real, numberMovies * numberFeatures), rating row starts (uint64, numberUsers + 1), rated movie ids (int32,
+ * numberRatings) and rates (Real, numberRatings). The movie arrays, and the rated movie ids and rates of an
+ * unsharded load, are read in place from the mapping, so processes loading the same snapshot share them, and only
+ * a build of the same Real type can load it
+ */
+
+#include "RecommenderSystem.h"
+#include "MappedFile.h"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+#define SNAPSHOT_MAGIC "RECS"
+#define SNAPSHOT_MAGIC_SIZE (4)
+#define SNAPSHOT_VERSION (3)
+#define SNAPSHOT_ALIGNMENT (8)
+
+/**
+ * @brief sections of the snapshot
+ */
+enum SnapshotSection
+{
+    MovieNameOffsets, MovieNameChars, UserNameOffsets, UserNameChars, Features, Norms, Units, RowStart, Columns,
+    Rates, NumberSections
+};
+
+/**
+ * @brief fixed size start of the snapshot file
+ */
+typedef struct SnapshotHeader
+{
+    char        magic[SNAPSHOT_MAGIC_SIZE];
+    uint32_t    version;
+    uint64_t    numberMovies;
+    uint64_t    numberRankMovies;
+    uint64_t    numberFeatures;
+    uint64_t    numberUsers;
+    uint64_t    numberRatings;
+    uint64_t    realSize; // sizeof(Real) of the writing build
+    uint64_t    offsets[NumberSections]; // file offset of each section
+    uint64_t    sizes[NumberSections]; // bytes of each section
+} SnapshotHeader;
+
+
+/**
+ * @brief names as one offsets array and one characters array
+ * @param names: names to flatten
+ * @param offsets: filled with names.size() + 1 offsets into chars
+ * @param chars: filled with the concatenated names
+ */
+static void flattenNames(const vector<string>& names, vector<uint64_t>& offsets, string& chars)
+{
+    offsets.assign(1, 0);
+    for (const auto& _name : names)
+    {
+        chars += _name;
+        offsets.push_back(chars.size());
+    }
+}
+
+
+/**
+ * @brief names back from flattenNames arrays
+ * @param offsets: count + 1 offsets into chars
+ * @param chars: concatenated names
+ * @param charsSize: bytes of chars
+ * @param count: number of names
+ * @param names: filled with the names
+ * @return false if the offsets don't fit chars
+ */
+static bool readNames(const uint64_t* offsets, const char* chars, const uint64_t charsSize, const uint64_t count,
+                      vector<string>& names)
+{
+    if ((offsets[0] != 0) || (offsets[count] != charsSize))
+    {
+        return false;
+    }
+    names.resize(count);
+    for (uint64_t index = 0; index < count; index++)
+    {
+        if (offsets[index] > offsets[index + 1])
+        {
+            return false;
+        }
+        names[index].assign(chars + offsets[index], offsets[index + 1] - offsets[index]);
+    }
+    return true;
+}
+
+
+/**
+ * @brief write the data
+ * @param path: file path
+ * @return true for success
+ */
+bool RecommenderSystem::saveSnapshot(const string& path) const
+{
+    vector<uint64_t> movieNameOffsets;
+    vector<uint64_t> userNameOffsets;
+    string movieNameChars;
+    string userNameChars;
+    flattenNames(_movieNames, movieNameOffsets, movieNameChars);
+    flattenNames(_userNames, userNameOffsets, userNameChars);
+    vector<uint64_t> rowStart(1, 0);
+    vector<int32_t> columns;
+    vector<Real> rates;
+    columns.reserve(_ratings.numberRatings());
+    rates.reserve(_ratings.numberRatings());
+    for (int userId = 0; userId < _ratings.numberRows(); userId++)
+    {
+        columns.insert(columns.end(), _ratings.movies(userId), _ratings.movies(userId) + _ratings.rowSize(userId));
+        rates.insert(rates.end(), _ratings.rates(userId), _ratings.rates(userId) + _ratings.rowSize(userId));
+        rowStart.push_back(columns.size());
+    }
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_SIZE);
+    header.version = SNAPSHOT_VERSION;
+    header.numberMovies = _movieNames.size();
+    header.numberRankMovies = (uint64_t)_numberRankMovies;
+    header.numberFeatures = (uint64_t)_numberFeatures;
+    header.numberUsers = _userNames.size();
+    header.numberRatings = _ratings.numberRatings();
+    header.realSize = sizeof(Real);
+    const void* sections[NumberSections] = {movieNameOffsets.data(), movieNameChars.data(), userNameOffsets.data(),
+                                            userNameChars.data(), _moviesFeatures.data(), _moviesNorm.data(),
+                                            _moviesUnit.data(), rowStart.data(), columns.data(), rates.data()};
+    header.sizes[MovieNameOffsets] = movieNameOffsets.size() * sizeof(uint64_t);
+    header.sizes[MovieNameChars] = movieNameChars.size();
+    header.sizes[UserNameOffsets] = userNameOffsets.size() * sizeof(uint64_t);
+    header.sizes[UserNameChars] = userNameChars.size();
+    header.sizes[Features] = _moviesFeatures.size() * sizeof(Real);
+    header.sizes[Norms] = _moviesNorm.size() * sizeof(Real);
+    header.sizes[Units] = _moviesUnit.size() * sizeof(Real);
+    header.sizes[RowStart] = (_userNames.size() + 1) * sizeof(uint64_t);
+    header.sizes[Columns] = _ratings.numberRatings() * sizeof(int32_t);
+    header.sizes[Rates] = _ratings.numberRatings() * sizeof(Real);
+    uint64_t offset = sizeof(SnapshotHeader);
+    for (int section = 0; section < NumberSections; section++)
+    {
+        header.offsets[section] = offset;
+        offset = (offset + header.sizes[section] + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT;
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    const char padding[SNAPSHOT_ALIGNMENT] = {};
+    file.write((const char*) &header, sizeof(header));
+    for (int section = 0; section < NumberSections; section++)
+    {
+        file.write((const char*) sections[section], header.sizes[section]);
+        uint64_t end = header.offsets[section] + header.sizes[section];
+        file.write(padding, (SNAPSHOT_ALIGNMENT - (end % SNAPSHOT_ALIGNMENT)) % SNAPSHOT_ALIGNMENT);
+    }
+    return file.good();
+}
+
+
+/**
+ * @brief read the data
+ * @param path: file path
+ * @param shard: index of the users shard to keep
+ * @param shards: number of shards, 1 for every user
+ * @return true for success
+ */
+bool RecommenderSystem::loadSnapshot(const string& path, const int shard, const int shards)
+{
+    std::shared_ptr<MappedFile> mapping = std::make_shared<MappedFile>();
+    const MappedFile& file = *mapping;
+    if ((shards < 1) || (shard < 0) || (shard >= shards) || !mapping->open(path) ||
+        (file.size() < sizeof(SnapshotHeader)))
+    {
+        return false;
+    }
+    SnapshotHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if ((std::memcmp(header.magic, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_SIZE) != 0) || (header.version != SNAPSHOT_VERSION) ||
+        (header.realSize != sizeof(Real)) || (header.numberRankMovies > header.numberMovies) ||
+        (header.numberMovies > INT32_MAX) || (header.numberUsers > INT32_MAX) || (header.numberFeatures > INT32_MAX) ||
+        (header.numberRatings > file.size()) ||
+        (header.numberMovies * header.numberFeatures > file.size() / sizeof(Real)))
+    {
+        return false;
+    }
+    const uint64_t expectedSizes[NumberSections] = {
+            (header.numberMovies + 1) * sizeof(uint64_t), header.sizes[MovieNameChars],
+            (header.numberUsers + 1) * sizeof(uint64_t), header.sizes[UserNameChars],
+            header.numberMovies * header.numberFeatures * sizeof(Real), header.numberMovies * sizeof(Real),
+            header.numberMovies * header.numberFeatures * sizeof(Real), (header.numberUsers + 1) * sizeof(uint64_t),
+            header.numberRatings * sizeof(int32_t), header.numberRatings * sizeof(Real)};
+
+    // pointer fixups: every section is read in place at the mapping base plus its offset
+    const void* sections[NumberSections];
+    for (int section = 0; section < NumberSections; section++)
+    {
+        if ((header.sizes[section] != expectedSizes[section]) || (header.offsets[section] % SNAPSHOT_ALIGNMENT != 0) ||
+            (header.offsets[section] > file.size()) || (header.sizes[section] > file.size() - header.offsets[section]))
+        {
+            return false;
+        }
+        sections[section] = file.data() + header.offsets[section];
+    }
+    const uint64_t* rowStart = (const uint64_t*) sections[RowStart];
+    if (rowStart[0] != 0 || rowStart[header.numberUsers] != header.numberRatings)
+    {
+        return false;
+    }
+    // every row holds strictly ascending rank movie ids with finite rates, as the lookups assume
+    const int* columns = (const int*) sections[Columns];
+    const Real* rates = (const Real*) sections[Rates];
+    for (uint64_t user = 0; user < header.numberUsers; user++)
+    {
+        if ((rowStart[user] > rowStart[user + 1]) || (rowStart[user + 1] - rowStart[user] > header.numberRankMovies))
+        {
+            return false;
+        }
+        for (uint64_t entry = rowStart[user]; entry < rowStart[user + 1]; entry++)
+        {
+            if ((columns[entry] < 0) || ((uint64_t)columns[entry] >= header.numberRankMovies) ||
+                ((entry > rowStart[user]) && (columns[entry] <= columns[entry - 1])) || !std::isfinite(rates[entry]))
+            {
+                return false;
+            }
+        }
+    }
+
+    RecommenderSystem loaded;
+    loaded._numberFeatures = (int)header.numberFeatures;
+    loaded._numberRankMovies = (int)header.numberRankMovies;
+    if (!readNames((const uint64_t*) sections[MovieNameOffsets], (const char*) sections[MovieNameChars],
+                   header.sizes[MovieNameChars], header.numberMovies, loaded._movieNames) ||
+        !readNames((const uint64_t*) sections[UserNameOffsets], (const char*) sections[UserNameChars],
+                   header.sizes[UserNameChars], header.numberUsers, loaded._userNames))
+    {
+        return false;
+    }
+    loaded._movieIds.reserve(loaded._movieNames.size());
+    for (int movieId = 0; movieId < (int)loaded._movieNames.size(); movieId++)
+    {
+        loaded._movieIds[loaded._movieNames[movieId]] = movieId;
+    }
+    if (loaded._movieIds.size() != loaded._movieNames.size())
+    {
+        return false; // a name given twice, the ids of its first copy would be unreachable
+    }
+    loaded._moviesFeatures.share(mapping, (const Real*) sections[Features],
+                                 header.numberMovies * header.numberFeatures);
+    loaded._moviesNorm.share(mapping, (const Real*) sections[Norms], header.numberMovies);
+    loaded._moviesUnit.share(mapping, (const Real*) sections[Units], header.numberMovies * header.numberFeatures);
+    static_assert(sizeof(size_t) == sizeof(uint64_t), "rating row starts are read in place as size_t");
+    if (shards == 1)
+    {
+        loaded.buildUsers((const size_t*) rowStart, columns, rates, mapping);
+    }
+    else
+    {
+        // keep the rows of the shard's users, in snapshot order
+        vector<string> shardNames;
+        vector<size_t> shardRowStart(1, 0);
+        vector<int> shardColumns;
+        vector<Real> shardRates;
+        for (uint64_t user = 0; user < header.numberUsers; user++)
+        {
+            if (userShard(loaded._userNames[user], shards) != shard)
+            {
+                continue;
+            }
+            shardNames.push_back(std::move(loaded._userNames[user]));
+            shardColumns.insert(shardColumns.end(), columns + rowStart[user], columns + rowStart[user + 1]);
+            shardRates.insert(shardRates.end(), rates + rowStart[user], rates + rowStart[user + 1]);
+            shardRowStart.push_back(shardColumns.size());
+        }
+        loaded._userNames = std::move(shardNames);
+        loaded.buildUsers(shardRowStart.data(), shardColumns.data(), shardRates.data());
+    }
+    if (loaded._userIds.size() != loaded._userNames.size())
+    {
+        return false;
+    }
+
+    *this = std::move(loaded);
+    return true;
+}
@@ -7,157 +7,321 @@
  */
 
 #include "RecommenderSystem.h"
-#include <fstream>
-#include <sstream>
+#include "Fnv1a.h"
+#include "TopK.h"
+#include "ParallelFor.h"
+#include "MappedFile.h"
+#include "TextLoader.h"
+#include "VectorKernels.h"
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
 
-#define DELIMITER_INPUT ' '
-#define NO_RANK "NA"
 #define EXIT_FAIL (-1)
 #define ERROR_MSG_USER_NOT_FOUND "USER NOT FOUND"
+#define BATCH_USERS_PER_CHUNK (64)
+#define SCORE_BLOCK_MOVIES (256) // movies scored per dotProducts call, small enough to stay in L1
+#define PRUNE_MIN_SEEN (64) // shorter histories are scored in full, the index wouldn't pay for itself
 
-using std::istringstream;
 
-static double calculateNorm (const valarray<double>& vec, int vectorSize);
-static double calculateDotProduct (const valarray<double>& leftVec, const valarray<double>& rightVec, int vectorSize);
-static double calculateExpectedRate(const unordered_map<string, double>& mostSimilarMap, const unordered_map<string,
-                                    double>& seenMovies);
+/**
+ * @brief expected rate from the k most similar seen movies
+ * @param similarities: (index in the user's row, similarity) of the scored seen movies, left with the k best
+ * @param seenRates: rates of the user's row
+ * @param k: a parameter to the filtering algorithm
+ * @return the similarity weighted average of their rates
+ */
+static double weightedRate(vector<ScoredId>& similarities, const Real* seenRates, const int k)
+{
+    // take the k maximal similarities (lower movie id on ties), then the expected rate is their weighted average
+    selectTopK(similarities, k);
+    double upperFraction = 0;
+    double bottomFraction = 0;
+    for (const auto& _similar : similarities)
+    {
+        upperFraction += _similar.second * seenRates[_similar.first];
+        bottomFraction += _similar.second;
+    }
+    return upperFraction / bottomFraction;
+}
 
 
 /**
  * @brief loading the data from the 2 files
  * @param moviesFeatureFilePath: path to features file
  * @param userRankFilePath: path to ranks file
+ * @param threads: number of parsing threads, 0 for every hardware thread
  * @return 0 for success and -1 for failure
  */
-int RecommenderSystem::loadData(const string& moviesFeatureFilePath, const string& userRankFilePath)
+int RecommenderSystem::loadData(const string& moviesFeatureFilePath, const string& userRankFilePath,
+                                const int threads)
 {
-    std::ifstream fileStreamFeature(moviesFeatureFilePath);
-    if (!fileStreamFeature.is_open())
+    MappedFile fileFeature;
+    if (!fileFeature.open(moviesFeatureFilePath))
     {
         std::cerr << "Unable to open file " << moviesFeatureFilePath << std::endl;
         return EXIT_FAIL;
     }
-    if (!fileStreamFeature.good())
+    MappedFile fileRank;
+    if (!fileRank.open(userRankFilePath))
     {
+        std::cerr << "Unable to open file " << userRankFilePath << std::endl;
         return EXIT_FAIL;
     }
 
-    std::ifstream fileStreamRank(userRankFilePath);
-    if (!fileStreamRank.is_open())
+    *this = RecommenderSystem();
+
+//-------------------- PARSE FILES -----------------------
+
+    // features are kept in file order until the rank file fixes the movie ids
+    string error;
+    FeatureTable features;
+    RankTable ranks;
+    if (!parseFeatures(fileFeature.data(), fileFeature.size(), threads, features, error) ||
+        !parseRanks(fileRank.data(), fileRank.size(), threads, ranks, error))
     {
-        std::cerr << "Unable to open file " << userRankFilePath << std::endl;
+        std::cerr << error << std::endl;
         return EXIT_FAIL;
     }
-    if (!fileStreamRank.good())
+    _numberFeatures = features._numberFeatures;
+
+//-------------------- INTERN MOVIES -----------------------
+
+    // movie ids follow the rank file columns, so comparing ids keeps the tie-breaking by column order
+    _movieNames = std::move(ranks._movies);
+    for (int movieId = 0; movieId < (int)_movieNames.size(); movieId++)
     {
-        return EXIT_FAIL;
+        _movieIds[_movieNames[movieId]] = movieId;
     }
+    _numberRankMovies = (int)_movieNames.size();
+    for (const auto& _movie : features._movies)
+    {
+        if (_movieIds.find(_movie) == _movieIds.end())
+        {
+            _movieIds[_movie] = (int)_movieNames.size();
+            _movieNames.push_back(_movie);
+        }
+    }
+    // feature rows are unique (parseFeatures), so each movie id below is written by one row only
+    vector<int> featureIds(features._movies.size());
+    vector<bool> hasFeatures(_movieNames.size(), false);
+    for (int index = 0; index < (int)features._movies.size(); index++)
+    {
+        featureIds[index] = _movieIds[features._movies[index]];
+        hasFeatures[featureIds[index]] = true;
+    }
+    for (int movieId = 0; movieId < _numberRankMovies; movieId++)
+    {
+        if (!hasFeatures[movieId])
+        {
+            std::cerr << "Missing features of movie " << _movieNames[movieId] << " of file " << userRankFilePath
+                      << std::endl;
+            return EXIT_FAIL;
+        }
+    }
+    vector<Real>& moviesFeatures = _moviesFeatures.owned();
+    vector<Real>& moviesNorm = _moviesNorm.owned();
+    moviesFeatures.resize(_movieNames.size() * _numberFeatures);
+    moviesNorm.resize(_movieNames.size());
+    parallelFor((int)featureIds.size(), threads, [&](int begin, int end)
+    {
+        for (int index = begin; index < end; index++)
+        {
+            int movieId = featureIds[index];
+            std::copy(features._rates.begin() + ((size_t)index * _numberFeatures),
+                      features._rates.begin() + ((size_t)(index + 1) * _numberFeatures),
+                      moviesFeatures.begin() + ((size_t)movieId * _numberFeatures));
+            moviesNorm[movieId] = vectorNorm(movieFeatures(movieId), _numberFeatures);
+        }
+    });
+    buildUnitRows(threads);
 
-//-------------------- LOAD FEATURES FILE -----------------------
+//-------------------- BUILD USERS -----------------------
+
+    _userNames = std::move(ranks._users);
+    buildUsers(ranks._rowStart.data(), ranks._columns.data(), ranks._rates.data());
+
+    return EXIT_SUCCESS;
+}
 
-    string line;
-    while (std::getline(fileStreamFeature, line))
-    {
-        std::istringstream iss(line);
-        string movieName;
-        std::getline(iss, movieName, DELIMITER_INPUT);
-        _moviesFeatures[movieName];
 
-        vector<double> tempVec;
-        int numFeatures = 0;
-        double featureRate;
-        while (iss >> featureRate)
+/**
+ * @brief compute the unit rows of the movie features
+ * @param threads: number of threads, 0 for every hardware thread
+ */
+void RecommenderSystem::buildUnitRows(const int threads)
+{
+    _moviesUnit.owned().resize(_moviesFeatures.size());
+    parallelFor((int)_movieNames.size(), threads, [&](int begin, int end)
+    {
+        for (int movieId = begin; movieId < end; movieId++)
         {
-            tempVec.push_back(featureRate);
-            numFeatures++;
+            updateUnitRow(movieId);
         }
-        valarray<double>tempVal (tempVec.size());
-        std::copy(begin(tempVec), end(tempVec), begin(tempVal));
-        _moviesNorm[movieName] = calculateNorm(tempVal, tempVec.size());
-        _moviesFeatures[movieName] = tempVal;
-        _numberFeatures = numFeatures;
+    });
+}
+
+
+/**
+ * @brief compute the unit row of one movie
+ * @param movieId: movie id
+ */
+void RecommenderSystem::updateUnitRow(const int movieId)
+{
+    // a zero vector keeps a zero unit row, as cosineSimilarity gives it similarity 0
+    Real norm = _moviesNorm[movieId];
+    const Real* features = movieFeatures(movieId);
+    Real* unit = &_moviesUnit.owned()[(size_t)movieId * _numberFeatures];
+    for (int feature = 0; feature < _numberFeatures; feature++)
+    {
+        unit[feature] = (norm > 0) ? features[feature] / norm : 0;
     }
+}
 
-//-------------------- LOAD RANK FILE -----------------------
 
-    string movieName;
-    std::getline(fileStreamRank, line);
-    std::istringstream iss(line);
-    vector<string> allMovies;
-    while (iss >> movieName)
+/**
+ * @brief build the users from their rated entries
+ * @param rowStart: _userNames.size() + 1 offsets of every user's entries
+ * @param columns: movie id of each entry, ascending within a user
+ * @param rates: rate of each entry
+ */
+void RecommenderSystem::buildUsers(const size_t* rowStart, const int* columns, const Real* rates,
+                                   std::shared_ptr<const MappedFile> mapping)
+{
+    _userIds.clear();
+    _userIds.reserve(_userNames.size());
+    for (int userId = 0; userId < (int)_userNames.size(); userId++)
     {
-        allMovies.push_back(movieName);
+        _userIds[_userNames[userId]] = userId;
     }
-    for (int index = 0; index < (int)allMovies.size(); index++)
+    if (mapping != nullptr)
     {
-        _allMoviesWithIndex[allMovies[index]] = index;
+        _ratings.share(std::move(mapping), rowStart, columns, rates, (int)_userNames.size());
     }
-
-    int counter = 0;
-    while (std::getline(fileStreamRank, line))
+    else
     {
-        std::istringstream iss(line);
-        string userName;
-        std::getline(iss, userName, DELIMITER_INPUT);
-        _users[userName];
-
-        string rank;
-        double numberSeen = 0;
-        while (iss >> rank)
-        {
-            if (rank == NO_RANK)
-            {
-                _users[userName]._unSeenMovies.push_back(allMovies[counter]);
-            }
-            else
-            {
-                _users[userName]._seenMovies[allMovies[counter]] = std::stod(rank);
-                numberSeen++;
-            }
-            counter++;
-        }
-        _users[userName]._numberSeenMovies = numberSeen;
-        counter = 0;
+        _ratings.assign(rowStart, columns, rates, (int)_userNames.size());
     }
+    _preferenceCache.reset((int)_userNames.size(), _numberFeatures);
+}
 
-    return EXIT_SUCCESS;
+
+/**
+ * @brief shard of a user - FNV-1a, so every process and build agrees
+ * @param userName: user name
+ * @param shards: number of shards
+ * @return shard index
+ */
+int RecommenderSystem::userShard(const string& userName, const int shards)
+{
+    return (int)(fnv1a(userName.data(), userName.size()) % (uint64_t)shards);
 }
 
 
 /**
- * @brief calculate the norm of a vector
- * @param vec: given vector to calculate norm of
- * @param vectorSize: size of vector
- * @return norm result
+ * @brief add or update a rating
+ * @param userName: user name, a new user is created if missing
+ * @param movieName: rank file movie
+ * @param rate: user rate
+ * @return true for success, false if the movie isn't a rank file movie
  */
-static double calculateNorm (const valarray<double>& vec, int vectorSize)
+bool RecommenderSystem::addRating(const string& userName, const string& movieName, const double rate)
 {
-    double result = 0;
-    for (int index = 0; index < vectorSize; index++)
+    auto movieIt = _movieIds.find(movieName);
+    if ((movieIt == _movieIds.end()) || (movieIt->second >= _numberRankMovies))
     {
-        result += pow(vec[index], 2.0);
+        return false;
     }
-    return sqrt(result);
+    auto userIt = _userIds.find(userName);
+    int userId = (userIt == _userIds.end()) ? -1 : userIt->second;
+    if (userId == -1)
+    {
+        userId = _ratings.addRow();
+        _userIds[userName] = userId;
+        _userNames.push_back(userName);
+        _preferenceCache.addUser();
+    }
+    _ratings.setRate(userId, movieIt->second, rate);
+    _preferenceCache.invalidate(userId);
+    if (!_factorModel.isEmpty())
+    {
+        _factorModel.updateUser(_ratings, userId);
+    }
+    return true;
 }
 
 
 /**
- * @brief calculate dot product of 2 vectors
- * @param leftVec: left vector in the product
- * @param rightVec: right vector in the product
- * @param vectorSize: size of the vectors
- * @return dot product result
+ * @brief delete a rating, the movie becomes unseen
+ * @param userName: user name
+ * @param movieName: movie name
+ * @return true if the user had rated the movie
  */
-static double calculateDotProduct (const valarray<double>& leftVec, const valarray<double>& rightVec, int vectorSize)
+bool RecommenderSystem::removeRating(const string& userName, const string& movieName)
 {
-    double result = 0;
-    for (int index = 0; index < vectorSize; index++)
+    auto userIt = _userIds.find(userName);
+    auto movieIt = _movieIds.find(movieName);
+    if ((userIt == _userIds.end()) || (movieIt == _movieIds.end()))
     {
-        result += leftVec[index] * rightVec[index];
+        return false;
     }
-    return result;
+    if (!_ratings.removeRate(userIt->second, movieIt->second))
+    {
+        return false;
+    }
+    _preferenceCache.invalidate(userIt->second);
+    if (!_factorModel.isEmpty())
+    {
+        _factorModel.updateUser(_ratings, userIt->second);
+    }
+    return true;
+}
+
+
+/**
+ * @brief add a movie to the catalogue as a new last rank file column
+ * @param movieName: new movie name
+ * @param features: its features
+ * @return true for success, false if the name exists or the number of features is wrong
+ */
+bool RecommenderSystem::addMovie(const string& movieName, const vector<double>& features)
+{
+    if ((_movieIds.find(movieName) != _movieIds.end()) || ((int)features.size() != _numberFeatures))
+    {
+        return false;
+    }
+
+    // the new column comes after every rank file movie, so movies only in the features file move up one id -
+    // no rating refers to them
+    int movieId = _numberRankMovies;
+    _movieNames.insert(_movieNames.begin() + movieId, movieName);
+    for (int id = movieId; id < (int)_movieNames.size(); id++)
+    {
+        _movieIds[_movieNames[id]] = id;
+    }
+    vector<Real>& moviesFeatures = _moviesFeatures.owned();
+    vector<Real>& moviesNorm = _moviesNorm.owned();
+    vector<Real>& moviesUnit = _moviesUnit.owned();
+    moviesFeatures.insert(moviesFeatures.begin() + ((size_t)movieId * _numberFeatures), features.begin(),
+                          features.end());
+    moviesNorm.insert(moviesNorm.begin() + movieId, vectorNorm(movieFeatures(movieId), _numberFeatures));
+    moviesUnit.insert(moviesUnit.begin() + ((size_t)movieId * _numberFeatures), _numberFeatures, 0);
+    updateUnitRow(movieId);
+    _numberRankMovies++;
+
+    if (!_similarityCache.isEmpty())
+    {
+        _similarityCache.insertMovie(movieId, _moviesFeatures.data(), _moviesNorm.data(), _numberFeatures);
+    }
+    if (!_contentIndex.isEmpty())
+    {
+        _contentIndex.insert(movieId, movieFeatures(movieId), _moviesNorm[movieId]);
+    }
+    if (!_factorModel.isEmpty())
+    {
+        _factorModel.addMovie();
+    }
+    return true;
 }
 
 
@@ -168,90 +332,162 @@ static double calculateDotProduct (const valarray<double>& leftVec, const valarr
  */
 string RecommenderSystem::recommendByContent(const string& userName) const
 {
-    if (_users.find(userName) == _users.end())
+    auto userIt = _userIds.find(userName);
+    if (userIt == _userIds.end())
     {
         return ERROR_MSG_USER_NOT_FOUND;
     }
+    int mostSimilarMovie = recommendContentById(userIt->second);
+    return (mostSimilarMovie == -1) ? string() : _movieNames[mostSimilarMovie];
+}
+
+
+/**
+ * @brief preference vector of a user: movie features weighted by the user's rates minus their average
+ * @param userId: user id
+ * @param preferVector: filled with _numberFeatures values
+ */
+void RecommenderSystem::computePreference(const int userId, Real* preferVector) const
+{
+    const int* seenMovies = _ratings.movies(userId);
+    const Real* seenRates = _ratings.rates(userId);
+    int numberSeen = _ratings.rowSize(userId);
 
     // calculate average
-    double average = 0;
-    for (const auto& _movie : _users.at(userName)._seenMovies)
+    Real average = 0;
+    for (int index = 0; index < numberSeen; index++)
     {
-        average += _movie.second;
+        average += seenRates[index];
     }
-    average /= _users.at(userName)._numberSeenMovies;
+    average /= numberSeen;
 
-    // normalizing rate vector
-    unordered_map<string, double> tempMap_seen = _users.at(userName)._seenMovies;
-    for (auto& _movie : tempMap_seen)
+    // calculating preferring vector from the normalized rates
+    std::fill(preferVector, preferVector + _numberFeatures, 0);
+    for (int index = 0; index < numberSeen; index++)
     {
-        _movie.second -= average;
+        Real normalizedRate = seenRates[index] - average;
+        const Real* features = movieFeatures(seenMovies[index]);
+        for (int feature = 0; feature < _numberFeatures; feature++)
+        {
+            preferVector[feature] += normalizedRate * features[feature];
+        }
     }
+}
 
-    // calculating preferring vector
-    valarray<double> preferVector (_numberFeatures);
-    for (const auto& _movie : tempMap_seen)
+
+/**
+ * @brief preference vector of a user, cached after the first query
+ * @param userId: user id
+ * @param scratch: holds the vector if it can't be cached now
+ * @param norm: filled with the vector norm
+ * @return pointer to the vector
+ */
+const Real* RecommenderSystem::preferenceVector(const int userId, vector<Real>& scratch, Real& norm) const
+{
+    const Real* cached = _preferenceCache.find(userId, norm);
+    if (cached != nullptr)
     {
-        preferVector += (_movie.second * _moviesFeatures.at(_movie.first));
+        return cached;
     }
-
-    // calculate similarity
-    unordered_map<string, double> similarityMap; // (movie_name, similarity_value)
-    double preferVectorNorm = calculateNorm(preferVector, _numberFeatures);
-
-    for (const auto& _movie : _users.at(userName)._unSeenMovies)
+    Real* slot = _preferenceCache.claim(userId);
+    Real* preferVector = slot;
+    if (slot == nullptr)
+    {
+        scratch.resize(_numberFeatures);
+        preferVector = scratch.data();
+    }
+    computePreference(userId, preferVector);
+    norm = vectorNorm(preferVector, _numberFeatures);
+    if (slot != nullptr)
     {
-        double dotProductResult = calculateDotProduct(preferVector, _moviesFeatures.at(_movie), _numberFeatures);
-        double movieNorm = _moviesNorm.at(_movie);
-        similarityMap[_movie] = dotProductResult / (preferVectorNorm * movieNorm);
+        _preferenceCache.publish(userId, norm);
     }
+    return preferVector;
+}
+
 
-    string mostSimilarMovie;
-    double maxSimilarity = 0;
-    bool firstElement = true;
-    for (const auto& _movie : similarityMap)
+/**
+ * @brief find the most similar movie according to a user preferences
+ * @param userId: user id
+ * @return the most recommended movie id, -1 if none
+ */
+int RecommenderSystem::recommendContentById(const int userId) const
+{
+    vector<ScoredId> best = topNContentById(userId, 1);
+    return best.empty() ? -1 : best[0].first;
+}
+
+
+/**
+ * @brief the unseen movies most similar to a user preferences
+ * @param userId: user id
+ * @param n: number of movies
+ * @return (movie id, similarity) ranked, lower id on ties
+ */
+vector<ScoredId> RecommenderSystem::topNContentById(const int userId, const int n) const
+{
+    vector<Real> scratch;
+    Real preferVectorNorm = 0;
+    const Real* preferVector = preferenceVector(userId, scratch, preferVectorNorm);
+
+    // score blocks of consecutive movies in one batched call, then skip the seen ones
+    const int* seen = _ratings.movies(userId);
+    const int* seenEnd = seen + _ratings.rowSize(userId);
+    Real scores[SCORE_BLOCK_MOVIES];
+    TopNHeap best(n);
+    for (int block = 0; block < _numberRankMovies; block += SCORE_BLOCK_MOVIES)
     {
-        if (firstElement)
-        {
-            maxSimilarity = _movie.second;
-            mostSimilarMovie = _movie.first;
-            firstElement = false;
-        }
-        else if (maxSimilarity < _movie.second)
-        {
-            maxSimilarity = _movie.second;
-            mostSimilarMovie = _movie.first;
-        }
-        else if (maxSimilarity == _movie.second)
+        int blockSize = std::min(SCORE_BLOCK_MOVIES, _numberRankMovies - block);
+        dotProducts(preferVector, movieFeatures(block), blockSize, _numberFeatures, scores);
+        for (int _movie = block; _movie < block + blockSize; _movie++)
         {
-            if (_allMoviesWithIndex.at(_movie.first) < _allMoviesWithIndex.at(mostSimilarMovie))
+            if ((seen < seenEnd) && (*seen == _movie))
             {
-                mostSimilarMovie = _movie.first;
+                seen++;
+                continue;
             }
+            best.push(_movie, cosineSimilarity(scores[_movie - block], preferVectorNorm, _moviesNorm[_movie]));
         }
     }
-    return mostSimilarMovie;
+    return best.take();
 }
 
 
 /**
- * @brief calculate the final expected rate of an unseen movie
- * @param mostSimilarMap: map of the most similar seen movies and their similarity value
- * @param seenMovies: map of seen movies and their's user's rate
- * @return final rate
+ * @brief index the rank file movies for recommendByContentApprox
+ * @param lists: number of IVF lists, 0 for sqrt(number of movies)
+ * @param threads: number of threads, 0 for every hardware thread
  */
-static double calculateExpectedRate(const unordered_map<string, double>& mostSimilarMap, const unordered_map<string,
-                                    double>& seenMovies)
+void RecommenderSystem::buildContentIndex(const int lists, const int threads)
 {
-    double upperFraction = 0;
-    double bottomFraction = 0;
-    for (const auto& _movie : mostSimilarMap)
-    {
-        upperFraction += (_movie.second * seenMovies.at(_movie.first));
-        bottomFraction += _movie.second;
+    _contentIndex.build(_moviesUnit.data(), _moviesFeatures.data(), _moviesNorm.data(), _numberRankMovies,
+                        _numberFeatures, lists, threads);
+}
+
 
+/**
+ * @brief recommendByContent through the content index
+ * @param userName: string of user's name to find a movie for
+ * @param nprobe: index lists scanned
+ * @return the name of the recommended movie
+ */
+string RecommenderSystem::recommendByContentApprox(const string& userName, const int nprobe) const
+{
+    auto userIt = _userIds.find(userName);
+    if (userIt == _userIds.end())
+    {
+        return ERROR_MSG_USER_NOT_FOUND;
     }
-    return upperFraction / bottomFraction;
+    if (_contentIndex.isEmpty())
+    {
+        return recommendByContent(userName);
+    }
+    vector<Real> scratch;
+    Real preferVectorNorm = 0;
+    const Real* preferVector = preferenceVector(userIt->second, scratch, preferVectorNorm);
+    int movieId = _contentIndex.search(preferVector, nprobe, _ratings.movies(userIt->second),
+                                       _ratings.rowSize(userIt->second));
+    return (movieId == -1) ? string() : _movieNames[movieId];
 }
 
 
@@ -264,46 +500,128 @@ static double calculateExpectedRate(const unordered_map<string, double>& mostSim
  */
 double RecommenderSystem::predictMovieScoreForUser(const string &movieName, const string &userName, int k) const
 {
-    if ((_users.find(userName) == _users.end()) || (_moviesFeatures.find(movieName) == _moviesFeatures.end()))
+    auto userIt = _userIds.find(userName);
+    auto movieIt = _movieIds.find(movieName);
+    if ((userIt == _userIds.end()) || (movieIt == _movieIds.end()))
     {
         return EXIT_FAIL;
     }
+    return predictById(movieIt->second, userIt->second, k);
+}
+
 
-    unordered_map<string, double> similarityMap; // (movie_name, similarity_value)
-    double unSeenVectorNorm = _moviesNorm.at(movieName);
-    for (const auto& _seenMovie : _users.at(userName)._seenMovies)
+/**
+ * @brief expected rate of a movie by the k most similar movies the user has seen
+ * @param movieId: movie id
+ * @param userId: user id
+ * @param k: a parameter to the filtering algorithm
+ * @return expected rate
+ */
+double RecommenderSystem::predictById(const int movieId, const int userId, const int k) const
+{
+    // no SeenIndex here: building one packs and bounds every seen movie, which costs more than the single scan it
+    // would prune. It pays off in topNCFById, where one index serves all the user's unseen movies
+    if (!_similarityCache.isEmpty() && !_similarityCache.isDense())
     {
-        double dotProductResult = calculateDotProduct(_moviesFeatures.at(movieName),
-                _moviesFeatures.at(_seenMovie.first), _numberFeatures);
-        double seenMovieNorm = _moviesNorm.at(_seenMovie.first);
-        similarityMap[_seenMovie.first] = dotProductResult / (unSeenVectorNorm * seenMovieNorm);
+        return predictByNeighbours(movieId, userId, k);
     }
+    return predictByScan(movieId, userId, k);
+}
+
 
-    unordered_map<string, double> mostSimilarMap; // (movie_name, similarity_value)
-    for (int i = 0; i < k; i++)
+/**
+ * @brief expected rate of a movie from the similarities of every seen movie
+ * @param movieId: movie id
+ * @param userId: user id
+ * @param k: a parameter to the filtering algorithm
+ * @return expected rate
+ */
+double RecommenderSystem::predictByScan(const int movieId, const int userId, const int k) const
+{
+    bool dense = !_similarityCache.isEmpty() && _similarityCache.isDense();
+    const int* seenMovies = _ratings.movies(userId);
+    const Real* seenRates = _ratings.rates(userId);
+    int numberSeen = _ratings.rowSize(userId);
+    vector<ScoredId> similarities; // (index in the user's row, similarity_value) - index order is movie id order
+    similarities.reserve(numberSeen);
+    const Real* unSeenVector = movieFeatures(movieId);
+    for (int index = 0; index < numberSeen; index++)
     {
-        double maxSimilarValue = 0;
-        string mostSimilarMovie;
-        bool firstElement = true;
-        for (const auto& _movie : similarityMap)
+        int seenMovie = seenMovies[index];
+        if (dense)
         {
-            if (firstElement)
-            {
-                maxSimilarValue = _movie.second;
-                mostSimilarMovie = _movie.first;
-                firstElement = false;
-            }
-            else if (maxSimilarValue < _movie.second)
-            {
-                maxSimilarValue = _movie.second;
-                mostSimilarMovie = _movie.first;
-            }
+            similarities.emplace_back(index, _similarityCache.similarity(movieId, seenMovie));
+            continue;
         }
-        mostSimilarMap[mostSimilarMovie] = maxSimilarValue;
-        similarityMap.erase(mostSimilarMovie);
+        similarities.emplace_back(index, cosineSimilarity(dotProduct(unSeenVector, movieFeatures(seenMovie),
+                                                                     _numberFeatures),
+                                                          _moviesNorm[movieId], _moviesNorm[seenMovie]));
     }
+    return weightedRate(similarities, seenRates, k);
+}
 
-    return calculateExpectedRate(mostSimilarMap, _users.at(userName)._seenMovies);
+
+/**
+ * @brief expected rate of a movie from the k most similar seen movies of an index
+ * @param movieId: movie id
+ * @param userId: user id
+ * @param k: a parameter to the filtering algorithm
+ * @param seenIndex: index of the user's seen movies
+ * @param similarities: scratch for the most similar
+ * @return the expected rate
+ */
+double RecommenderSystem::predictIndexed(const int movieId, const int userId, const int k, SeenIndex& seenIndex,
+                                         vector<ScoredId>& similarities) const
+{
+    seenIndex.mostSimilar(unitFeatures(movieId), movieFeatures(movieId), _moviesNorm[movieId], k, similarities);
+    return weightedRate(similarities, _ratings.rates(userId), k);
+}
+
+
+/**
+ * @brief expected rate of a movie from its cached neighbours the user has seen
+ * @param movieId: movie id
+ * @param userId: user id
+ * @param k: a parameter to the filtering algorithm
+ * @return expected rate
+ */
+double RecommenderSystem::predictByNeighbours(const int movieId, const int userId, const int k) const
+{
+    // neighbours are sorted like the exact top-k (similarity, then lower id), so once k seen ones (or every seen
+    // movie) are found they are the movies the scan would pick
+    const int* neighbours = _similarityCache.neighbourIds(movieId);
+    const Real* neighbourSimilarity = _similarityCache.neighbourSimilarity(movieId);
+    double upperFraction = 0;
+    double bottomFraction = 0;
+    int found = 0;
+    for (int rank = 0; (rank < _similarityCache.getTopM()) && (found < k); rank++)
+    {
+        Real rate;
+        if (_ratings.findRate(userId, neighbours[rank], rate))
+        {
+            upperFraction += neighbourSimilarity[rank] * rate;
+            bottomFraction += neighbourSimilarity[rank];
+            found++;
+        }
+    }
+    if (found < std::min(k, _ratings.rowSize(userId)))
+    {
+        // a seen movie past the top-M may still be among the k most similar, only the full scan knows
+        return predictByScan(movieId, userId, k);
+    }
+    return upperFraction / bottomFraction;
+}
+
+
+/**
+ * @brief build the item-item similarity cache
+ * @param topM: neighbours kept per movie, 0 for the full matrix
+ * @param threads: number of threads, 0 for every hardware thread
+ */
+void RecommenderSystem::buildSimilarityCache(const int topM, const int threads)
+{
+    _similarityCache.build(_moviesFeatures.data(), _moviesNorm.data(), (int)_movieNames.size(), _numberFeatures, topM,
+                           threads);
 }
 
 
@@ -315,36 +633,348 @@ double RecommenderSystem::predictMovieScoreForUser(const string &movieName, cons
  */
 string RecommenderSystem::recommendByCF(const string& userName, int k) const
 {
-    if (_users.find(userName) == _users.end())
+    auto userIt = _userIds.find(userName);
+    if (userIt == _userIds.end())
     {
         return ERROR_MSG_USER_NOT_FOUND;
     }
+    int mostSimilarMovie = recommendCFById(userIt->second, k);
+    return (mostSimilarMovie == -1) ? string() : _movieNames[mostSimilarMovie];
+}
+
 
-    string mostSimilarMovie;
-    double maxSimilarValue = 0;
-    bool firstElement = true;
-    for (const auto& _unSeenMovie : _users.at(userName)._unSeenMovies)
+/**
+ * @brief find the movie to be the most recommended by given user according to movies he had been seen
+ * @param userId: user id
+ * @param k: a parameter to the filtering algorithm
+ * @return the most recommended movie id, -1 if none
+ */
+int RecommenderSystem::recommendCFById(const int userId, const int k) const
+{
+    vector<ScoredId> best = topNCFById(userId, 1, k);
+    return best.empty() ? -1 : best[0].first;
+}
+
+
+/**
+ * @brief the unseen movies with the highest expected rates
+ * @param userId: user id
+ * @param n: number of movies
+ * @param k: a parameter to the filtering algorithm
+ * @return (movie id, expected rate) ranked, lower id on ties
+ */
+vector<ScoredId> RecommenderSystem::topNCFById(const int userId, const int n, const int k) const
+{
+    TopNHeap best(n);
+    int numberSeen = _ratings.rowSize(userId);
+    if (!_pruneCF || !_similarityCache.isEmpty() || (k < 1) || (numberSeen < PRUNE_MIN_SEEN))
     {
-        double result = predictMovieScoreForUser(_unSeenMovie, userName, k);
-        if (firstElement)
+        forEachUnseen(userId, [&](int _unSeenMovie)
         {
-            maxSimilarValue = result;
-            mostSimilarMovie = _unSeenMovie;
-            firstElement = false;
+            best.push(_unSeenMovie, predictById(_unSeenMovie, userId, k));
+        });
+        return best.take();
+    }
+
+    SeenIndex seenIndex(_moviesUnit.data(), _moviesFeatures.data(), _moviesNorm.data(), _numberFeatures,
+                        _ratings.movies(userId), numberSeen);
+    vector<ScoredId> similarities;
+    forEachUnseen(userId, [&](int _unSeenMovie)
+    {
+        best.push(_unSeenMovie, predictIndexed(_unSeenMovie, userId, k, seenIndex, similarities));
+    });
+    return best.take();
+}
+
+
+/**
+ * @brief ranked recommendation list by content
+ * @param userName: user name
+ * @param n: number of movies
+ * @return (movie name, similarity) pairs
+ */
+vector<std::pair<string, double>> RecommenderSystem::recommendTopNByContent(const string& userName, const int n) const
+{
+    auto userIt = _userIds.find(userName);
+    return (userIt == _userIds.end()) ? vector<std::pair<string, double>>()
+                                      : namedScores(topNContentById(userIt->second, n));
+}
+
+
+/**
+ * @brief ranked recommendation list by collaborative filtering
+ * @param userName: user name
+ * @param n: number of movies
+ * @param k: a parameter to the filtering algorithm
+ * @return (movie name, expected rate) pairs
+ */
+vector<std::pair<string, double>> RecommenderSystem::recommendTopNByCF(const string& userName, const int n,
+                                                                       const int k) const
+{
+    auto userIt = _userIds.find(userName);
+    return (userIt == _userIds.end()) ? vector<std::pair<string, double>>()
+                                      : namedScores(topNCFById(userIt->second, n, k));
+}
+
+
+/**
+ * @brief movie names of ranked ids
+ * @param scores: (movie id, score) pairs
+ * @return (movie name, score) pairs in the same order
+ */
+vector<std::pair<string, double>> RecommenderSystem::namedScores(const vector<ScoredId>& scores) const
+{
+    vector<std::pair<string, double>> named;
+    named.reserve(scores.size());
+    for (const auto& _score : scores)
+    {
+        named.emplace_back(_movieNames[_score.first], _score.second);
+    }
+    return named;
+}
+
+
+/**
+ * @brief recommendByContent for every user
+ * @param threads: number of threads, 0 for every hardware thread
+ * @return (user_name, recommended movie) per user
+ */
+vector<std::pair<string, string>> RecommenderSystem::recommendAllByContent(const int threads) const
+{
+    vector<std::pair<string, string>> results(_userNames.size());
+    parallelForChunks((int)_userNames.size(), threads, BATCH_USERS_PER_CHUNK, [&](int begin, int end)
+    {
+        vector<vector<ScoredId>> best;
+        topNContentBatch(begin, end - begin, 1, best);
+        for (int userId = begin; userId < end; userId++)
+        {
+            const vector<ScoredId>& userBest = best[userId - begin];
+            results[userId].first = _userNames[userId];
+            results[userId].second = userBest.empty() ? string() : _movieNames[userBest[0].first];
         }
-        else if (maxSimilarValue < result)
+    });
+    return results;
+}
+
+
+/**
+ * @brief recommendTopNByContent for every user
+ * @param n: number of movies per user
+ * @param threads: number of threads, 0 for every hardware thread
+ * @return ranked (movie name, similarity) pairs per user
+ */
+vector<vector<std::pair<string, double>>> RecommenderSystem::recommendTopNAllByContent(const int n,
+                                                                                      const int threads) const
+{
+    vector<vector<std::pair<string, double>>> results(_userNames.size());
+    parallelForChunks((int)_userNames.size(), threads, BATCH_USERS_PER_CHUNK, [&](int begin, int end)
+    {
+        vector<vector<ScoredId>> best;
+        topNContentBatch(begin, end - begin, n, best);
+        for (int userId = begin; userId < end; userId++)
         {
-            maxSimilarValue = result;
-            mostSimilarMovie = _unSeenMovie;
+            results[userId] = namedScores(best[userId - begin]);
         }
-        else if (maxSimilarValue == result)
+    });
+    return results;
+}
+
+
+/**
+ * @brief topNContentById for consecutive users, scored together by a matrix product
+ * @param firstUser: id of the first user
+ * @param numberUsers: number of users
+ * @param n: number of movies per user
+ * @param results: filled with the ranked (movie id, similarity) pairs of every user
+ */
+void RecommenderSystem::topNContentBatch(const int firstUser, const int numberUsers, const int n,
+                                         vector<vector<ScoredId>>& results) const
+{
+    // stack the preference vectors, one matrix row per user
+    vector<Real> preferMatrix((size_t)numberUsers * _numberFeatures);
+    vector<Real> preferNorms(numberUsers);
+    vector<Real> scratch;
+    for (int user = 0; user < numberUsers; user++)
+    {
+        const Real* preferVector = preferenceVector(firstUser + user, scratch, preferNorms[user]);
+        std::copy(preferVector, preferVector + _numberFeatures,
+                  preferMatrix.begin() + ((size_t)user * _numberFeatures));
+    }
+
+    // score a block of movies for all the users at once, then mask each user's seen movies
+    vector<const int*> seen(numberUsers);
+    vector<TopNHeap> best(numberUsers, TopNHeap(n));
+    for (int user = 0; user < numberUsers; user++)
+    {
+        seen[user] = _ratings.movies(firstUser + user);
+    }
+    vector<Real> scores((size_t)numberUsers * SCORE_BLOCK_MOVIES);
+    for (int block = 0; block < _numberRankMovies; block += SCORE_BLOCK_MOVIES)
+    {
+        int blockSize = std::min(SCORE_BLOCK_MOVIES, _numberRankMovies - block);
+        dotProductsMatrix(preferMatrix.data(), numberUsers, movieFeatures(block), blockSize, _numberFeatures,
+                          scores.data());
+        for (int user = 0; user < numberUsers; user++)
         {
-            if (_allMoviesWithIndex.at(_unSeenMovie) < _allMoviesWithIndex.at(mostSimilarMovie))
+            const int* seenEnd = _ratings.movies(firstUser + user) + _ratings.rowSize(firstUser + user);
+            const Real* userScores = scores.data() + ((size_t)user * blockSize);
+            for (int _movie = block; _movie < block + blockSize; _movie++)
             {
-                mostSimilarMovie = _unSeenMovie;
+                if ((seen[user] < seenEnd) && (*seen[user] == _movie))
+                {
+                    seen[user]++;
+                    continue;
+                }
+                best[user].push(_movie, cosineSimilarity(userScores[_movie - block], preferNorms[user],
+                                                         _moviesNorm[_movie]));
             }
         }
     }
+    results.resize(numberUsers);
+    for (int user = 0; user < numberUsers; user++)
+    {
+        results[user] = best[user].take();
+    }
+}
+
 
-    return mostSimilarMovie;
+/**
+ * @brief recommendByCF for every user
+ * @param k: a parameter to the filtering algorithm
+ * @param threads: number of threads, 0 for every hardware thread
+ * @return (user_name, recommended movie) per user
+ */
+vector<std::pair<string, string>> RecommenderSystem::recommendAllByCF(const int k, const int threads) const
+{
+    vector<std::pair<string, string>> results(_userNames.size());
+    parallelForChunks((int)_userNames.size(), threads, BATCH_USERS_PER_CHUNK, [&](int begin, int end)
+    {
+        for (int userId = begin; userId < end; userId++)
+        {
+            int movieId = recommendCFById(userId, k);
+            results[userId].first = _userNames[userId];
+            results[userId].second = (movieId == -1) ? string() : _movieNames[movieId];
+        }
+    });
+    return results;
+}
+
+
+/**
+ * @brief learn the ALS factor model
+ * @param factors: latent factors per user and movie, 0 for the default
+ * @param iterations: ALS alternations, 0 for the default
+ * @param regularization: penalty on the factors per rating, 0 for the default
+ * @param threads: number of threads, 0 for every hardware thread
+ */
+void RecommenderSystem::buildFactorModel(const int factors, const int iterations, const double regularization,
+                                         const int threads)
+{
+    _factorModel.train(_ratings, _numberRankMovies, factors, iterations, regularization, threads);
+}
+
+
+/**
+ * @brief predicted user rate of a movie by the factor model
+ * @param movieName: movie name
+ * @param userName: user name
+ * @return predicted rate, -1 if unavailable
+ */
+double RecommenderSystem::predictByFactors(const string& movieName, const string& userName) const
+{
+    auto userIt = _userIds.find(userName);
+    auto movieIt = _movieIds.find(movieName);
+    if ((userIt == _userIds.end()) || (movieIt == _movieIds.end()) || (movieIt->second >= _numberRankMovies) ||
+        _factorModel.isEmpty())
+    {
+        return EXIT_FAIL;
+    }
+    return _factorModel.predict(userIt->second, movieIt->second);
+}
+
+
+/**
+ * @brief recommendByCF with the factor model
+ * @param userName: user name
+ * @return the recommended movie name
+ */
+string RecommenderSystem::recommendByFactors(const string& userName) const
+{
+    auto userIt = _userIds.find(userName);
+    if (userIt == _userIds.end())
+    {
+        return ERROR_MSG_USER_NOT_FOUND;
+    }
+    vector<ScoredId> best = topNFactorsById(userIt->second, 1);
+    return best.empty() ? string() : _movieNames[best[0].first];
+}
+
+
+/**
+ * @brief ranked recommendation list by the factor model
+ * @param userName: user name
+ * @param n: number of movies
+ * @return (movie name, predicted rate) pairs
+ */
+vector<std::pair<string, double>> RecommenderSystem::recommendTopNByFactors(const string& userName, const int n) const
+{
+    auto userIt = _userIds.find(userName);
+    return (userIt == _userIds.end()) ? vector<std::pair<string, double>>()
+                                      : namedScores(topNFactorsById(userIt->second, n));
+}
+
+
+/**
+ * @brief recommendByFactors for every user
+ * @param threads: number of threads, 0 for every hardware thread
+ * @return (user_name, recommended movie) per user
+ */
+vector<std::pair<string, string>> RecommenderSystem::recommendAllByFactors(const int threads) const
+{
+    vector<std::pair<string, string>> results(_userNames.size());
+    parallelForChunks((int)_userNames.size(), threads, BATCH_USERS_PER_CHUNK, [&](int begin, int end)
+    {
+        for (int userId = begin; userId < end; userId++)
+        {
+            vector<ScoredId> best = topNFactorsById(userId, 1);
+            results[userId].first = _userNames[userId];
+            results[userId].second = best.empty() ? string() : _movieNames[best[0].first];
+        }
+    });
+    return results;
+}
+
+
+/**
+ * @brief the unseen movies with the highest rates predicted by the factor model
+ * @param userId: user id
+ * @param n: number of movies
+ * @return (movie id, predicted rate) ranked, lower id on ties
+ */
+vector<ScoredId> RecommenderSystem::topNFactorsById(const int userId, const int n) const
+{
+    if (_factorModel.isEmpty())
+    {
+        return vector<ScoredId>();
+    }
+    const int* seen = _ratings.movies(userId);
+    const int* seenEnd = seen + _ratings.rowSize(userId);
+    double scores[SCORE_BLOCK_MOVIES];
+    TopNHeap best(n);
+    for (int block = 0; block < _numberRankMovies; block += SCORE_BLOCK_MOVIES)
+    {
+        int blockSize = std::min(SCORE_BLOCK_MOVIES, _numberRankMovies - block);
+        dotProducts(_factorModel.userFactors(userId), _factorModel.movieFactors(block), blockSize,
+                    _factorModel.getNumberFactors(), scores);
+        for (int _movie = block; _movie < block + blockSize; _movie++)
+        {
+            if ((seen < seenEnd) && (*seen == _movie))
+            {
+                seen++;
+                continue;
+            }
+            best.push(_movie, _factorModel.getMean() + scores[_movie - block]);
+        }
+    }
+    return best.take();
 }
@@ -9,16 +9,24 @@
 #ifndef EX5_RECOMMENDERSYSTEM_H
 #define EX5_RECOMMENDERSYSTEM_H
 
+#include <memory>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
-#include <valarray>
 #include <iostream>
+#include "ContentIndex.h"
+#include "FactorModel.h"
+#include "PreferenceCache.h"
+#include "RatingMatrix.h"
+#include "SeenIndex.h"
+#include "SharedArray.h"
+#include "SimilarityCache.h"
+#include "TopK.h"
 
 using std::string;
 using std::unordered_map;
 using std::vector;
-using std::valarray;
 
 /**
  * @brief class representing a recommending movie system
@@ -26,31 +34,266 @@ using std::valarray;
 class RecommenderSystem
 {
     private:
+        vector<string>                          _movieNames; // (movie_id -> movie_name), rank file column order first
+        unordered_map<string, int>              _movieIds; // (movie_name -> movie_id)
+        SharedArray<Real>                       _moviesFeatures; // row-major (movie_id, feature) rates
+        SharedArray<Real>                       _moviesNorm; // (movie_id -> movie_vector_norm)
+        SharedArray<Real>                       _moviesUnit; // _moviesFeatures rows / norm, for clustering, bounds
+        vector<string>                          _userNames; // (user_id -> user_name)
+        unordered_map<string, int>              _userIds; // (user_name -> user_id)
+        RatingMatrix                            _ratings; // user_id rows of (movie_id, user_rate), unseen are the rest
+        int                                     _numberFeatures;
+        int                                     _numberRankMovies; // movies of the rank file (ids 0..n-1)
+        SimilarityCache                         _similarityCache; // optional item-item similarities for CF
+        ContentIndex                            _contentIndex; // optional ANN index of the rank file movies
+        FactorModel                             _factorModel; // optional ALS latent factors for CF
+        PreferenceCache                         _preferenceCache; // content preference vector of every user
+        bool                                    _pruneCF; // CF of heavy users through SeenIndex bounds
+
         /**
-         * @brief class representing a user in the cinema
+         * @brief features row of a movie
+         * @param movieId: interned movie id
+         * @return pointer to _numberFeatures rates
          */
-        class User
+        const Real* movieFeatures(int movieId) const
         {
-            public:
-                unordered_map<string, double>   _seenMovies; // map(movie_name, user_rate)
-                vector<string>                  _unSeenMovies;
-                double                          _numberSeenMovies;
-        };
-        unordered_map<string, valarray<double>> _moviesFeatures; // map(movie_name, valarray(features_rate))
-        unordered_map<string, double>           _moviesNorm; // map(movie_name, movie_vector_norm)
-        unordered_map<string, User>             _users; // map(user_name, User)
-        unordered_map<string, int>              _allMoviesWithIndex; //(movie_name, index)
-        int                                     _numberFeatures;
+            return _moviesFeatures.data() + ((size_t)movieId * _numberFeatures);
+        }
+
+        /**
+         * @brief unit features row of a movie, for the content index clustering and the SeenIndex bounds (scores
+         * come from cosineSimilarity of the features, which keeps exact ties)
+         * @param movieId: interned movie id
+         * @return pointer to _numberFeatures values
+         */
+        const Real* unitFeatures(int movieId) const
+        {
+            return _moviesUnit.data() + ((size_t)movieId * _numberFeatures);
+        }
+
+        /**
+         * @brief compute _moviesUnit from _moviesFeatures and _moviesNorm
+         * @param threads: number of threads, 0 for every hardware thread
+         */
+        void buildUnitRows(int threads);
+
+        /**
+         * @brief compute the _moviesUnit row of one movie from its features and norm
+         * @param movieId: movie id
+         */
+        void updateUnitRow(int movieId);
+
+        /**
+         * @brief call function(movieId) on every rank file movie the user hasn't rated, in ascending id order
+         * @param userId: user id
+         * @param function: callable taking the movie id
+         */
+        template <class Function>
+        void forEachUnseen(const int userId, Function function) const
+        {
+            const int* seen = _ratings.movies(userId);
+            const int* seenEnd = seen + _ratings.rowSize(userId);
+            for (int movieId = 0; movieId < _numberRankMovies; movieId++)
+            {
+                if ((seen < seenEnd) && (*seen == movieId))
+                {
+                    seen++;
+                    continue;
+                }
+                function(movieId);
+            }
+        }
+
+        /**
+         * @brief predictMovieScoreForUser on interned ids
+         * @param movieId: movie id
+         * @param userId: user id
+         * @param k: a parameter to the filtering algorithm
+         * @return expected rate
+         */
+        double predictById(int movieId, int userId, int k) const;
+
+        /**
+         * @brief predictById computing the similarity of every seen movie, from the full cache matrix if there is one
+         * @param movieId: movie id
+         * @param userId: user id
+         * @param k: a parameter to the filtering algorithm
+         * @return expected rate
+         */
+        double predictByScan(int movieId, int userId, int k) const;
+
+        /**
+         * @brief predictById through an index of the user's seen movies
+         * @param movieId: movie id
+         * @param userId: user id
+         * @param k: a parameter to the filtering algorithm, at least 1
+         * @param seenIndex: index of the user's seen movies
+         * @param similarities: scratch for the most similar
+         * @return the expected rate, equal to predictById
+         */
+        double predictIndexed(int movieId, int userId, int k, SeenIndex& seenIndex,
+                              vector<ScoredId>& similarities) const;
+
+        /**
+         * @brief build _userIds and _ratings for _userNames from their rated entries
+         * @param rowStart: _userNames.size() + 1 offsets of every user's entries
+         * @param columns: movie id of each entry, ascending within a user
+         * @param rates: rate of each entry
+         * @param mapping: mapping holding columns and rates to read them in place, nullptr to copy them
+         */
+        void buildUsers(const size_t* rowStart, const int* columns, const Real* rates,
+                        std::shared_ptr<const MappedFile> mapping = nullptr);
+
+        /**
+         * @brief predictById walking the cached top-M neighbours of the movie
+         * @param movieId: movie id
+         * @param userId: user id
+         * @param k: a parameter to the filtering algorithm
+         * @return expected rate from the k most similar seen movies (all of them if fewer) when the neighbours
+         * hold that many, predictByScan otherwise
+         */
+        double predictByNeighbours(int movieId, int userId, int k) const;
+
+        /**
+         * @brief compute the preference vector of a user for content recommendations
+         * @param userId: user id
+         * @param preferVector: filled with _numberFeatures values
+         */
+        void computePreference(int userId, Real* preferVector) const;
+
+        /**
+         * @brief preference vector of a user, from the cache or computed once and cached
+         * @param userId: user id
+         * @param scratch: holds the vector when another thread is caching it meanwhile
+         * @param norm: filled with the vector norm
+         * @return pointer to _numberFeatures values, valid until the user's ratings change
+         */
+        const Real* preferenceVector(int userId, vector<Real>& scratch, Real& norm) const;
+
+        /**
+         * @brief recommendByContent on interned ids
+         * @param userId: user id
+         * @return recommended movie id, -1 if the user has no unseen movie
+         */
+        int recommendContentById(int userId) const;
+
+        /**
+         * @brief recommendTopNByContent on interned ids, one scoring pass into a bounded heap
+         * @param userId: user id
+         * @param n: number of movies
+         * @return (movie id, similarity) ranked, lower id on ties
+         */
+        vector<ScoredId> topNContentById(int userId, int n) const;
+
+        /**
+         * @brief topNContentById for consecutive users: their preference vectors are stacked into a matrix and
+         * multiplied by blocks of the movie rows, then the seen movies are masked per user
+         * @param firstUser: id of the first user
+         * @param numberUsers: number of users
+         * @param n: number of movies per user
+         * @param results: filled with numberUsers ranked (movie id, similarity) lists, equal to topNContentById
+         */
+        void topNContentBatch(int firstUser, int numberUsers, int n, vector<vector<ScoredId>>& results) const;
+
+        /**
+         * @brief recommendTopNByFactors on interned ids, one dot product per unseen movie
+         * @param userId: user id
+         * @param n: number of movies
+         * @return (movie id, predicted rate) ranked, lower id on ties, empty without a factor model
+         */
+        vector<ScoredId> topNFactorsById(int userId, int n) const;
+
+        /**
+         * @brief recommendByCF on interned ids
+         * @param userId: user id
+         * @param k: a parameter to the filtering algorithm
+         * @return recommended movie id, -1 if the user has no unseen movie
+         */
+        int recommendCFById(int userId, int k) const;
+
+        /**
+         * @brief recommendTopNByCF on interned ids, one scoring pass into a bounded heap
+         * @param userId: user id
+         * @param n: number of movies
+         * @param k: a parameter to the filtering algorithm
+         * @return (movie id, expected rate) ranked, lower id on ties
+         */
+        vector<ScoredId> topNCFById(int userId, int n, int k) const;
+
+        /**
+         * @brief attach the movie names to ranked ids
+         * @param scores: (movie id, score) pairs
+         * @return (movie name, score) pairs in the same order
+         */
+        vector<std::pair<string, double>> namedScores(const vector<ScoredId>& scores) const;
 
     public:
 
+        /**
+         * @brief constructor - empty system
+         */
+        RecommenderSystem() : _numberFeatures(0), _numberRankMovies(0), _pruneCF(true) {}
+
         /**
          * @brief load the data from the input files
          * @param moviesFeatureFilePath: path to features file
          * @param userRankFilePath: path to user ranks file
+         * @param threads: number of parsing threads, 0 for every hardware thread
          * @return 0 for success and 1 for failure
          */
-        int loadData(const string& moviesFeatureFilePath, const string& userRankFilePath);
+        int loadData(const string& moviesFeatureFilePath, const string& userRankFilePath, int threads = 0);
+
+        /**
+         * @brief save the loaded data (names, features, norms and ratings) in a binary snapshot
+         * @param path: file path
+         * @return true for success
+         */
+        bool saveSnapshot(const string& path) const;
+
+        /**
+         * @brief replace the data by a snapshot written with saveSnapshot on a machine of the same byte order and
+         * by a build of the same Real type (see Real.h), much faster than loadData on the text files. The movie
+         * features are read in place from the mapped file until the first addMovie, and with a single shard the
+         * ratings until the first rating change, so processes loading the same snapshot share one copy
+         * @param path: file path
+         * @param shard: index of the users shard to keep, see userShard
+         * @param shards: number of shards, 1 to keep every user
+         * @return true for success, on failure the system is unchanged
+         */
+        bool loadSnapshot(const string& path, int shard = 0, int shards = 1);
+
+        /**
+         * @brief shard of a user when the users are split between processes, a stable hash of the name
+         * @param userName: user name
+         * @param shards: number of shards
+         * @return shard index in [0, shards)
+         */
+        static int userShard(const string& userName, int shards);
+
+        /**
+         * @brief add or update a rating without reloading - updates must not run concurrently with queries
+         * @param userName: user name, a new user is created if missing
+         * @param movieName: a rank file movie
+         * @param rate: user rate
+         * @return true for success, false if the movie isn't a rank file movie
+         */
+        bool addRating(const string& userName, const string& movieName, double rate);
+
+        /**
+         * @brief delete a rating without reloading, the movie becomes unseen
+         * @param userName: user name
+         * @param movieName: movie name
+         * @return true if the user had rated the movie
+         */
+        bool removeRating(const string& userName, const string& movieName);
+
+        /**
+         * @brief add a movie after the last rank file column, updating the similarity cache and the content index
+         * @param movieName: new movie name
+         * @param features: its features
+         * @return true for success, false if the name exists or the number of features is wrong
+         */
+        bool addMovie(const string& movieName, const vector<double>& features);
 
         /**
          * @brief find the most similar movie according to a user preferences
@@ -59,6 +302,22 @@ class RecommenderSystem
          */
         string recommendByContent(const string& userName) const;
 
+        /**
+         * @brief build the approximate nearest-neighbour (IVF) index used by recommendByContentApprox
+         * @param lists: number of lists, 0 for sqrt(number of movies)
+         * @param threads: number of threads, 0 for every hardware thread
+         */
+        void buildContentIndex(int lists = 0, int threads = 0);
+
+        /**
+         * @brief recommendByContent in sub-linear time, scanning only the index lists closest to the user's
+         * preferences (recommendByContent itself when no index was built)
+         * @param userName: string of user's name to find a movie for
+         * @param nprobe: lists scanned - more is higher recall and latency, all lists is an exact scan
+         * @return the name of the recommended unseen movie, empty if the probed lists hold none
+         */
+        string recommendByContentApprox(const string& userName, int nprobe) const;
+
         /**
          * @brief calculate the expected rate of an unseen movie according to given user's perefences
          * @param movieName: unseen movie given
@@ -75,6 +334,129 @@ class RecommenderSystem
         * @return the most recommended movie
         */
         string recommendByCF(const string& userName, int k) const;
+
+        /**
+         * @brief the n movies recommendByContent would rank first
+         * @param userName: user name
+         * @param n: number of movies
+         * @return (movie name, similarity) pairs, best first and earlier rank file column on ties, empty for an
+         * unknown user
+         */
+        vector<std::pair<string, double>> recommendTopNByContent(const string& userName, int n) const;
+
+        /**
+         * @brief the n movies recommendByCF would rank first
+         * @param userName: user name
+         * @param n: number of movies
+         * @param k: a parameter to the filtering algorithm
+         * @return (movie name, expected rate) pairs, best first and earlier rank file column on ties, empty for an
+         * unknown user
+         */
+        vector<std::pair<string, double>> recommendTopNByCF(const string& userName, int n, int k) const;
+
+        /**
+         * @brief recommendByContent for every user, users split between threads
+         * @param threads: number of threads, 0 for every hardware thread
+         * @return (user_name, recommended movie) of every user, in rank file order
+         */
+        vector<std::pair<string, string>> recommendAllByContent(int threads = 0) const;
+
+        /**
+         * @brief recommendTopNByContent for every user, scored in batches of users by one matrix product per block
+         * of movies
+         * @param n: number of movies per user
+         * @param threads: number of threads, 0 for every hardware thread
+         * @return ranked (movie name, similarity) pairs of every user, in rank file order
+         */
+        vector<vector<std::pair<string, double>>> recommendTopNAllByContent(int n, int threads = 0) const;
+
+        /**
+         * @brief recommendByCF for every user, users split between threads
+         * @param k: a parameter to the filtering algorithm
+         * @param threads: number of threads, 0 for every hardware thread
+         * @return (user_name, recommended movie) of every user, in rank file order
+         */
+        vector<std::pair<string, string>> recommendAllByCF(int k, int threads = 0) const;
+
+        /**
+         * @brief precompute item-item similarities so CF scoring becomes table lookups
+         * @param topM: neighbours kept per movie (for large catalogues, a prediction finding fewer than k seen
+         * neighbours falls back to a scan), 0 for the full matrix
+         * @param threads: number of threads, 0 for every hardware thread
+         */
+        void buildSimilarityCache(int topM = 0, int threads = 0);
+
+        /**
+         * @brief choose how the CF recommendations of users with a long history find the k most similar seen movies
+         * (on by default): through a SeenIndex of the user, which skips the blocks of seen movies that can't reach
+         * them, or by scoring every seen movie. The recommendations are the same either way; unused with a
+         * similarity cache
+         * @param enabled: true to prune
+         */
+        void setCFPruning(const bool enabled) {_pruneCF = enabled; }
+
+        /**
+         * @brief learn the ALS factor model used by the *ByFactors methods, a CF engine beside the item-item one:
+         * training costs a few passes over the ratings, then a prediction is a single dot product. Rating changes
+         * and new movies update it in place, a new build retrains it
+         * @param factors: latent factors per user and movie, 0 for the default (16)
+         * @param iterations: ALS alternations, 0 for the default (10)
+         * @param regularization: penalty on the factors per rating, 0 for the default (0.1)
+         * @param threads: number of threads, 0 for every hardware thread
+         */
+        void buildFactorModel(int factors = 0, int iterations = 0, double regularization = 0, int threads = 0);
+
+        /**
+         * @brief predicted user rate of a movie by the factor model
+         * @param movieName: movie name
+         * @param userName: user name
+         * @return predicted rate, -1 if the user or movie is unknown, the movie is not in the rank file or no
+         * model was built
+         */
+        double predictByFactors(const string& movieName, const string& userName) const;
+
+        /**
+         * @brief recommendByCF with the factor model
+         * @param userName: user name
+         * @return the unseen movie with the highest predicted rate, empty without a factor model
+         */
+        string recommendByFactors(const string& userName) const;
+
+        /**
+         * @brief the n movies recommendByFactors would rank first
+         * @param userName: user name
+         * @param n: number of movies
+         * @return (movie name, predicted rate) pairs, best first and earlier rank file column on ties, empty for an
+         * unknown user or without a factor model
+         */
+        vector<std::pair<string, double>> recommendTopNByFactors(const string& userName, int n) const;
+
+        /**
+         * @brief recommendByFactors for every user, users split between threads
+         * @param threads: number of threads, 0 for every hardware thread
+         * @return (user_name, recommended movie) of every user, in rank file order
+         */
+        vector<std::pair<string, string>> recommendAllByFactors(int threads = 0) const;
+
+        /**
+         * @brief save the similarity cache
+         * @param path: file path
+         * @return true for success
+         */
+        bool saveSimilarityCache(const string& path) const
+        {
+            return _similarityCache.save(path, _moviesFeatures.data(), _numberFeatures);
+        }
+
+        /**
+         * @brief load a similarity cache saved for the same data
+         * @param path: file path
+         * @return true for success, false if it doesn't match the movie features
+         */
+        bool loadSimilarityCache(const string& path)
+        {
+            return _similarityCache.load(path, _moviesFeatures.data(), (int)_movieNames.size(), _numberFeatures);
+        }
 };
 
 
@@ -0,0 +1,166 @@
+/**
+ * @file ScalingBenchmark.cpp
+ * @author  Jonathan Birnbaum
+ * @date 18/06/2020
+ *
+ * @brief benchmark of the single user APIs as the data grows: load time, memory footprint and per-query latency
+ * of recommendByContent, predictMovieScoreForUser and recommendByCF. Every size runs in its own process, so its
+ * memory footprint isn't hidden by the allocations of the sizes before it
+ */
+
+#include "BenchmarkData.h"
+#include "RecommenderSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define DEFAULT_MOVIES (1000)
+#define DEFAULT_USERS (1000)
+#define DEFAULT_FEATURES (20)
+#define DEFAULT_NA_FRACTION (0.95)
+#define DEFAULT_STEPS (3)
+#define DEFAULT_K (10)
+#define QUERY_SAMPLES (200)
+#define P99 (0.99)
+#define KB_PER_MB (1024.0)
+#define FEATURES_PATH "scaling_features.txt"
+#define RANKS_PATH "scaling_ranks.txt"
+#define RSS_FIELD "VmRSS:"
+#define USAGE "Usage: ScalingBenchmark [movies >= 2] [users >= 1] [features >= 1] [NA fraction] [steps >= 1]"
+
+
+/**
+ * @brief resident memory of this process
+ * @return resident set size in kB, 0 if unknown
+ */
+static long residentKb()
+{
+    std::ifstream status("/proc/self/status");
+    string field;
+    while (status >> field)
+    {
+        if (field == RSS_FIELD)
+        {
+            long kb = 0;
+            status >> kb;
+            return kb;
+        }
+    }
+    return 0;
+}
+
+
+/**
+ * @brief time a query for sample users spread over the data
+ * @param users: number of users, at least 1
+ * @param query: callable taking a user name
+ * @param mean: filled with the mean latency in microseconds
+ * @param p99: filled with the 99th percentile latency in microseconds
+ */
+template <class Query>
+static void queryLatency(int users, Query query, double& mean, double& p99)
+{
+    int samples = std::min(users, QUERY_SAMPLES);
+    vector<double> latencies;
+    for (int sample = 0; sample < samples; sample++)
+    {
+        string user = "user" + std::to_string((long)sample * users / samples);
+        auto start = std::chrono::steady_clock::now();
+        query(user);
+        std::chrono::duration<double, std::micro> time = std::chrono::steady_clock::now() - start;
+        latencies.push_back(time.count());
+    }
+    std::sort(latencies.begin(), latencies.end());
+    mean = 0;
+    for (double latency : latencies)
+    {
+        mean += latency;
+    }
+    mean /= latencies.size();
+    p99 = latencies[std::min(latencies.size() - 1, (size_t)(P99 * latencies.size()))];
+}
+
+
+/**
+ * @brief generate, load and query one data size, printing its table row
+ * @param movies: number of movies
+ * @param users: number of users
+ * @param features: features per movie
+ * @param naFraction: fraction of unrated entries
+ * @return true for success
+ */
+static bool benchmarkSize(int movies, int users, int features, double naFraction)
+{
+    if (!writeBenchmarkData(FEATURES_PATH, RANKS_PATH, movies, users, features, naFraction))
+    {
+        return false;
+    }
+    long before = residentKb();
+    auto start = std::chrono::steady_clock::now();
+    RecommenderSystem recommender;
+    if (recommender.loadData(FEATURES_PATH, RANKS_PATH) != 0)
+    {
+        return false;
+    }
+    std::chrono::duration<double> loadTime = std::chrono::steady_clock::now() - start;
+    double memory = (residentKb() - before) / KB_PER_MB;
+
+    // every user leaves the last movie unrated
+    string unseen = "movie" + std::to_string(movies - 1);
+    double contentMean, contentP99, predictMean, predictP99, cfMean, cfP99;
+    queryLatency(users, [&](const string& user) {recommender.recommendByContent(user); },
+                 contentMean, contentP99);
+    queryLatency(users, [&](const string& user) {recommender.predictMovieScoreForUser(unseen, user, DEFAULT_K); },
+                 predictMean, predictP99);
+    queryLatency(users, [&](const string& user) {recommender.recommendByCF(user, DEFAULT_K); }, cfMean, cfP99);
+    printf("%8d %8d %9.3f %10.1f %9.1f/%-9.1f %9.1f/%-9.1f %9.1f/%-9.1f\n", movies, users, loadTime.count(),
+           memory, contentMean, contentP99, predictMean, predictP99, cfMean, cfP99);
+    fflush(stdout);
+    return true;
+}
+
+
+int main(int argc, char* argv[])
+{
+    int movies = (argc > 1) ? std::atoi(argv[1]) : DEFAULT_MOVIES;
+    int users = (argc > 2) ? std::atoi(argv[2]) : DEFAULT_USERS;
+    int features = (argc > 3) ? std::atoi(argv[3]) : DEFAULT_FEATURES;
+    double naFraction = (argc > 4) ? std::atof(argv[4]) : DEFAULT_NA_FRACTION;
+    int steps = (argc > 5) ? std::atoi(argv[5]) : DEFAULT_STEPS;
+    // every user leaves a movie unrated and the latencies average over at least one user
+    if ((movies < 2) || (users < 1) || (features < 1) || (steps < 1))
+    {
+        std::cerr << USAGE << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    printf("%d features, %.2f NA, k = %d, latencies in us (mean/p99) over %d users\n", features, naFraction,
+           DEFAULT_K, std::min(users, QUERY_SAMPLES));
+    printf("%8s %8s %9s %10s %19s %19s %19s\n", "movies", "users", "load[s]", "memory[MB]", "content", "predict",
+           "cf");
+    fflush(stdout);
+    for (int step = 0; step < steps; step++, movies *= 2, users *= 2)
+    {
+        pid_t child = fork();
+        if (child < 0)
+        {
+            return EXIT_FAILURE;
+        }
+        if (child == 0)
+        {
+            _exit(benchmarkSize(movies, users, features, naFraction) ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+        int status = 0;
+        if ((waitpid(child, &status, 0) != child) || !WIFEXITED(status) || (WEXITSTATUS(status) != EXIT_SUCCESS))
+        {
+            printf("size %d x %d failed\n", movies, users);
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
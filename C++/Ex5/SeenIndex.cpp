@@ -0,0 +1,136 @@
+/**
+ * @file SeenIndex.cpp
+ * @author  Jonathan Birnbaum
+ * @date 18/06/2020
+ *
+ * @brief SeenIndex class implementation
+ */
+
+#include "SeenIndex.h"
+#include "VectorKernels.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+#define BLOCK_MOVIES (32)
+#define SEEN_PIVOTS (16)
+#define BOUND_SLACK_EPSILONS (4) // rounding room per feature and unit of sum |q_f * v_f|: a bound on the unit
+                                 // rows and a cosine of the features round differently
+
+
+/**
+ * @brief constructor - pack the seen rows and bound the blocks
+ */
+SeenIndex::SeenIndex(const Real* unitRows, const Real* rows, const Real* norms, const int numberFeatures,
+                     const int* seenMovies, const int numberSeen)
+        : _numberFeatures(numberFeatures), _numberSeen(numberSeen),
+          _numberBlocks((numberSeen + BLOCK_MOVIES - 1) / BLOCK_MOVIES)
+{
+    // farthest-first pivots, every movie joins its most similar pivot, most similar first - blocks of a group
+    // are then tight shells around it
+    vector<int> pivot(numberSeen, 0);
+    vector<Real> pivotSimilarity(numberSeen, std::numeric_limits<Real>::lowest());
+    int next = 0;
+    for (int pivotIndex = 0; pivotIndex < std::min(SEEN_PIVOTS, numberSeen); pivotIndex++)
+    {
+        const Real* pivotRow = unitRows + ((size_t)seenMovies[next] * numberFeatures);
+        for (int index = 0; index < numberSeen; index++)
+        {
+            Real similarity = dotProduct(pivotRow, unitRows + ((size_t)seenMovies[index] * numberFeatures),
+                                         numberFeatures);
+            if (similarity > pivotSimilarity[index])
+            {
+                pivotSimilarity[index] = similarity;
+                pivot[index] = pivotIndex;
+            }
+            if (pivotSimilarity[index] < pivotSimilarity[next])
+            {
+                next = index;
+            }
+        }
+    }
+    for (int index = 0; index < numberSeen; index++)
+    {
+        _order.push_back(index);
+    }
+    std::stable_sort(_order.begin(), _order.end(), [&pivot, &pivotSimilarity](int left, int right)
+    {
+        return (pivot[left] != pivot[right]) ? (pivot[left] < pivot[right])
+                                             : (pivotSimilarity[left] > pivotSimilarity[right]);
+    });
+
+    _rows.resize((size_t)numberSeen * numberFeatures);
+    _norms.resize(numberSeen);
+    _low.assign((size_t)_numberBlocks * numberFeatures, std::numeric_limits<Real>::max());
+    _high.assign((size_t)_numberBlocks * numberFeatures, std::numeric_limits<Real>::lowest());
+    for (int position = 0; position < numberSeen; position++)
+    {
+        int movie = seenMovies[_order[position]];
+        const Real* row = rows + ((size_t)movie * numberFeatures);
+        std::copy(row, row + numberFeatures, _rows.begin() + ((size_t)position * numberFeatures));
+        _norms[position] = norms[movie];
+        const Real* unitRow = unitRows + ((size_t)movie * numberFeatures);
+        Real* low = &_low[(size_t)(position / BLOCK_MOVIES) * numberFeatures];
+        Real* high = &_high[(size_t)(position / BLOCK_MOVIES) * numberFeatures];
+        for (int feature = 0; feature < numberFeatures; feature++)
+        {
+            low[feature] = std::min(low[feature], unitRow[feature]);
+            high[feature] = std::max(high[feature], unitRow[feature]);
+        }
+    }
+    _blocks.resize(_numberBlocks);
+    _similarities.resize(BLOCK_MOVIES);
+}
+
+
+/**
+ * @brief the k seen movies most similar to a movie
+ * @param unitQuery: unit features of the movie
+ * @param query: features of the movie
+ * @param queryNorm: norm of the movie
+ * @param k: number of movies
+ * @param best: filled with (seen index, similarity) ranked
+ */
+void SeenIndex::mostSimilar(const Real* unitQuery, const Real* query, const Real queryNorm, const int k,
+                            vector<ScoredId>& best)
+{
+    // every product q_f * v_f is at most the larger of q_f * low_f and q_f * high_f. The rounding error of a sum
+    // of n products grows with n and with the sum of their magnitudes, which the magnitudes of the bound's terms
+    // bound as well. The unit rows and the division of the cosine round once more each
+    Real slack = BOUND_SLACK_EPSILONS * (_numberFeatures + 2) * std::numeric_limits<Real>::epsilon();
+    for (int block = 0; block < _numberBlocks; block++)
+    {
+        const Real* low = &_low[(size_t)block * _numberFeatures];
+        const Real* high = &_high[(size_t)block * _numberFeatures];
+        Real bound = 0;
+        Real magnitude = 0;
+        for (int feature = 0; feature < _numberFeatures; feature++)
+        {
+            Real lowTerm = unitQuery[feature] * low[feature];
+            Real highTerm = unitQuery[feature] * high[feature];
+            bound += std::max(lowTerm, highTerm);
+            magnitude += std::max(std::abs(lowTerm), std::abs(highTerm));
+        }
+        _blocks[block] = ScoredId(block, bound + (slack * magnitude));
+    }
+    std::sort(_blocks.begin(), _blocks.end(), scoredBefore);
+
+    // a block whose bound is below the k-th best can't change the top k, nor can any block after it
+    TopNHeap top(k);
+    for (const auto& _block : _blocks)
+    {
+        if (top.isFull() && (_block.second < top.worst().second))
+        {
+            break;
+        }
+        int first = _block.first * BLOCK_MOVIES;
+        int size = std::min(BLOCK_MOVIES, _numberSeen - first);
+        dotProducts(query, &_rows[(size_t)first * _numberFeatures], size, _numberFeatures, _similarities.data());
+        for (int position = first; position < first + size; position++)
+        {
+            top.push(_order[position], cosineSimilarity(_similarities[position - first], queryNorm, _norms[position]));
+        }
+    }
+    best = top.take();
+}
@@ -0,0 +1,65 @@
+/**
+* @file SeenIndex.h
+* @author  Jonathan Birnbaum
+* @date 18/06/2020
+*
+* @brief SeenIndex class declaration and documentation
+*/
+
+#ifndef EX5_SEENINDEX_H
+#define EX5_SEENINDEX_H
+
+#include <vector>
+#include "Real.h"
+#include "TopK.h"
+
+using std::vector;
+
+/**
+ * @brief the rows of the movies one user has seen, packed in blocks with the low and high value of every unit
+ * feature in the block. A block bounds the similarity of all its movies to a query at once, so the k most similar
+ * are found by scoring blocks in decreasing bound order until no block left can reach the k-th best (a threshold
+ * algorithm), without the rest of the history. Movies are grouped around a few spread out pivots to keep the
+ * bounds tight. Built once per user query and reused by all its candidates
+ */
+class SeenIndex
+{
+    private:
+        int               _numberFeatures;
+        int               _numberSeen;
+        int               _numberBlocks;
+        vector<int>       _order; // seen index of every packed row
+        vector<Real>      _rows; // row-major packed feature rows
+        vector<Real>      _norms; // norm of every packed row
+        vector<Real>      _low; // row-major (block, feature) lowest unit value
+        vector<Real>      _high; // row-major (block, feature) highest unit value
+        vector<ScoredId>  _blocks; // scratch: (block, similarity bound)
+        vector<Real>      _similarities; // scratch: dot products of one block
+
+    public:
+
+        /**
+         * @brief constructor - pack the seen rows and bound the blocks
+         * @param unitRows: row-major unit features of every movie, for the bounds
+         * @param rows: row-major features of every movie, for the similarities
+         * @param norms: norm of every movie
+         * @param numberFeatures: features per movie
+         * @param seenMovies: ids of the seen movies
+         * @param numberSeen: number of seen movies
+         */
+        SeenIndex(const Real* unitRows, const Real* rows, const Real* norms, int numberFeatures, const int* seenMovies,
+                  int numberSeen);
+
+        /**
+         * @brief the k seen movies most similar to a movie
+         * @param unitQuery: unit features of the movie
+         * @param query: features of the movie
+         * @param queryNorm: norm of the movie
+         * @param k: number of movies
+         * @param best: filled with (seen index, similarity) ranked, lower index on ties - the pairs selectTopK
+         * would keep out of the similarities of every seen movie
+         */
+        void mostSimilar(const Real* unitQuery, const Real* query, Real queryNorm, int k, vector<ScoredId>& best);
+};
+
+#endif //EX5_SEENINDEX_H
@@ -0,0 +1,190 @@
+/**
+ * @file ShardRouter.cpp
+ * @author  Jonathan Birnbaum
+ * @date 18/06/2020
+ *
+ * @brief ShardRouter class implementation
+ */
+
+#include "ShardRouter.h"
+#include "RecommenderQuery.h"
+#include "RecommenderSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <functional>
+#include <thread>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#define CONNECT_RETRY_MS (10)
+
+
+/**
+ * @brief answer the query lines of one connection
+ * @param recommender: the worker's shard
+ * @param fd: connected descriptor, closed at the end
+ */
+static void serveConnection(const RecommenderSystem& recommender, const int fd)
+{
+    LineReader reader(fd);
+    string line;
+    Query query;
+    while (reader.readLine(line))
+    {
+        string reply = parseQuery(line, query) ? answerQuery(recommender, query) : QUERY_INVALID_REPLY;
+        if (!writeLine(fd, reply))
+        {
+            break;
+        }
+    }
+    close(fd);
+}
+
+
+/**
+ * @brief worker process body: load a shard and answer its connections, a thread each, until killed
+ * @param snapshotPath: snapshot path
+ * @param shard: shard index
+ * @param shards: number of shards
+ * @param socketPath: socket to listen on
+ */
+static void runWorker(const string& snapshotPath, const int shard, const int shards, const string& socketPath)
+{
+    RecommenderSystem recommender;
+    int listener = -1;
+    if (!recommender.loadSnapshot(snapshotPath, shard, shards) || ((listener = listenUnixSocket(socketPath)) < 0))
+    {
+        _exit(EXIT_FAILURE);
+    }
+    while (true)
+    {
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd >= 0)
+        {
+            std::thread(serveConnection, std::cref(recommender), fd).detach();
+        }
+    }
+}
+
+
+/**
+ * @brief fork the workers and connect to them
+ */
+bool ShardRouter::start(const string& snapshotPath, const int shards, const string& socketDirectory,
+                        const int connectionsPerShard)
+{
+    stop();
+    if (shards < 1)
+    {
+        return false;
+    }
+    _numberShards = shards;
+    _connectionsPerShard = std::max(1, connectionsPerShard);
+    for (int shard = 0; shard < shards; shard++)
+    {
+        _socketPaths.push_back(socketDirectory + "/shard" + std::to_string(getpid()) + "_" + std::to_string(shard) +
+                               ".sock");
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            runWorker(snapshotPath, shard, shards, _socketPaths[shard]);
+        }
+        if (pid < 0)
+        {
+            stop();
+            return false;
+        }
+        _workers.push_back(pid);
+    }
+    _locks.reset(new std::mutex[(size_t)shards * _connectionsPerShard]);
+    for (int shard = 0; shard < shards; shard++)
+    {
+        if (!connectWorker(shard))
+        {
+            stop();
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/**
+ * @brief connect to a starting worker
+ */
+bool ShardRouter::connectWorker(const int shard)
+{
+    for (int connection = 0; connection < _connectionsPerShard; connection++)
+    {
+        int fd;
+        while ((fd = connectUnixSocket(_socketPaths[shard])) < 0)
+        {
+            // the worker listens once its shard is loaded
+            int status;
+            if (waitpid(_workers[shard], &status, WNOHANG) != 0)
+            {
+                _workers[shard] = -1;
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(CONNECT_RETRY_MS));
+        }
+        _connections.push_back(fd);
+        _readers.emplace_back(fd);
+    }
+    return true;
+}
+
+
+/**
+ * @brief forward a query to the worker of its user
+ */
+string ShardRouter::query(const string& line)
+{
+    Query query;
+    if (!parseQuery(line, query))
+    {
+        return QUERY_INVALID_REPLY;
+    }
+    int shard = RecommenderSystem::userShard(query.user, _numberShards);
+    size_t connection = ((size_t)shard * _connectionsPerShard) + (_nextConnection++ % _connectionsPerShard);
+    std::lock_guard<std::mutex> lock(_locks[connection]);
+    string reply;
+    if (!writeLine(_connections[connection], line) || !_readers[connection].readLine(reply))
+    {
+        return SHARD_UNAVAILABLE_REPLY;
+    }
+    return reply;
+}
+
+
+/**
+ * @brief stop the workers
+ */
+void ShardRouter::stop()
+{
+    for (int _fd : _connections)
+    {
+        close(_fd);
+    }
+    for (pid_t _worker : _workers)
+    {
+        if (_worker > 0)
+        {
+            kill(_worker, SIGTERM);
+            waitpid(_worker, nullptr, 0);
+        }
+    }
+    for (const auto& _path : _socketPaths)
+    {
+        unlink(_path.c_str());
+    }
+    _connections.clear();
+    _readers.clear();
+    _workers.clear();
+    _socketPaths.clear();
+    _locks.reset();
+    _numberShards = 0;
+}
@@ -0,0 +1,94 @@
+/**
+* @file ShardRouter.h
+* @author  Jonathan Birnbaum
+* @date 18/06/2020
+*
+* @brief ShardRouter class declaration and documentation
+*/
+
+#ifndef EX5_SHARDROUTER_H
+#define EX5_SHARDROUTER_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include "UnixSocket.h"
+
+using std::string;
+using std::vector;
+
+#define SHARD_UNAVAILABLE_REPLY "SHARD UNAVAILABLE"
+
+/**
+ * @brief sharded deployment on one host: the users are split by RecommenderSystem::userShard between worker
+ * processes, each loading only its users from a snapshot whose movie arrays all of them map in place, and the
+ * router forwards every query line to the worker of its user over a Unix socket
+ */
+class ShardRouter
+{
+    private:
+        int                             _numberShards;
+        int                             _connectionsPerShard;
+        vector<pid_t>                   _workers;
+        vector<string>                  _socketPaths;
+        vector<int>                     _connections; // _connectionsPerShard per shard
+        vector<LineReader>              _readers; // matching _connections
+        std::unique_ptr<std::mutex[]>   _locks; // one query at a time per connection
+        std::atomic<unsigned int>       _nextConnection;
+
+        /**
+         * @brief connect to a starting worker, waiting until it listens
+         * @param shard: shard index
+         * @return false if the worker exited
+         */
+        bool connectWorker(int shard);
+
+    public:
+
+        /**
+         * @brief constructor - no workers
+         */
+        ShardRouter() : _numberShards(0), _connectionsPerShard(0), _nextConnection(0) {}
+
+        ShardRouter(const ShardRouter&) = delete;
+        ShardRouter& operator=(const ShardRouter&) = delete;
+
+        /**
+         * @brief destructor - stops the workers
+         */
+        ~ShardRouter() {stop(); }
+
+        /**
+         * @brief fork the workers and connect to them, before the calling process starts other threads
+         * @param snapshotPath: snapshot written by RecommenderSystem::saveSnapshot
+         * @param shards: number of worker processes
+         * @param socketDirectory: directory of the worker socket files
+         * @param connectionsPerShard: concurrent queries per worker
+         * @return true once every worker answers, false (nothing left running) if one failed to load
+         */
+        bool start(const string& snapshotPath, int shards, const string& socketDirectory,
+                   int connectionsPerShard = 4);
+
+        /**
+         * @brief forward a query to the worker of its user, safe to call from many threads
+         * @param line: query line, see RecommenderQuery.h
+         * @return the worker reply, QUERY_INVALID_REPLY or SHARD_UNAVAILABLE_REPLY
+         */
+        string query(const string& line);
+
+        /**
+         * @brief stop the workers and remove their sockets
+         */
+        void stop();
+
+        /**
+         * @brief getter number of shards
+         * @return running worker processes
+         */
+        int getNumberShards() const {return _numberShards; }
+};
+
+#endif //EX5_SHARDROUTER_H
@@ -0,0 +1,101 @@
+/**
+* @file SharedArray.h
+* @author  Jonathan Birnbaum
+* @date 18/06/2020
+*
+* @brief SharedArray class declaration and implementation
+*/
+
+#ifndef EX5_SHAREDARRAY_H
+#define EX5_SHAREDARRAY_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "MappedFile.h"
+
+using std::vector;
+
+/**
+ * @brief read-mostly array that either owns its values or reads them in place from a mapped file, so processes
+ * mapping the same snapshot share one copy in the page cache. The first change copies a mapped array out
+ */
+template <class T>
+class SharedArray
+{
+    private:
+        std::shared_ptr<const MappedFile>   _file; // keeps the mapping of a shared array alive
+        const T*                            _shared;
+        size_t                              _sharedSize;
+        vector<T>                           _owned;
+
+    public:
+
+        /**
+         * @brief constructor - empty owned array
+         */
+        SharedArray() : _shared(nullptr), _sharedSize(0) {}
+
+        /**
+         * @brief read the values in place from a mapping
+         * @param file: mapping holding the values
+         * @param values: first value, inside the mapping
+         * @param size: number of values
+         */
+        void share(std::shared_ptr<const MappedFile> file, const T* values, const size_t size)
+        {
+            _file = std::move(file);
+            _shared = values;
+            _sharedSize = size;
+            _owned = vector<T>();
+        }
+
+        /**
+         * @brief the values as an owned vector to change, copied out of the mapping first if shared
+         * @return the owned values
+         */
+        vector<T>& owned()
+        {
+            if (isShared())
+            {
+                _owned.assign(_shared, _shared + _sharedSize);
+                _file.reset();
+                _shared = nullptr;
+                _sharedSize = 0;
+            }
+            return _owned;
+        }
+
+        /**
+         * @brief check where the values live
+         * @return true if they are read from a mapping
+         */
+        bool isShared() const {return _file != nullptr; }
+
+        /**
+         * @brief getter values
+         * @return first value
+         */
+        const T* data() const {return isShared() ? _shared : _owned.data(); }
+
+        /**
+         * @brief getter size
+         * @return number of values
+         */
+        size_t size() const {return isShared() ? _sharedSize : _owned.size(); }
+
+        /**
+         * @brief getter owned memory
+         * @return bytes allocated for owned values, 0 while shared
+         */
+        size_t ownedBytes() const {return _owned.capacity() * sizeof(T); }
+
+        /**
+         * @brief value lookup
+         * @param index: value index
+         * @return the value
+         */
+        const T& operator[](const size_t index) const {return data()[index]; }
+};
+
+#endif //EX5_SHAREDARRAY_H
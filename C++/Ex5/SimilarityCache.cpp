@@ -0,0 +1,328 @@
+/**
+ * @file SimilarityCache.cpp
+ * @author  Jonathan Birnbaum
+ * @date 18/06/2020
+ *
+ * @brief SimilarityCache class implementation
+ */
+
+#include "SimilarityCache.h"
+#include "Fnv1a.h"
+#include "ParallelFor.h"
+#include "TopK.h"
+#include "VectorKernels.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+
+#define SIMILARITY_MAGIC "SIMC"
+#define SIMILARITY_MAGIC_SIZE (4)
+#define SIMILARITY_VERSION (4)
+#define SIMILARITY_HEADER_SIZE (5)
+#define SPARE_FRACTION (8) // spare rows and columns of the full matrix, in 1/SPARE_FRACTION of the movies
+#define MIN_SPARE (16)
+
+
+/**
+ * @brief checksum of the features a cache was computed from
+ * @param rows: row-major movie features
+ * @param numberMovies: number of movies
+ * @param numberFeatures: features per movie
+ * @return hash of the feature bits
+ */
+static uint64_t featuresChecksum(const Real* rows, const int numberMovies, const int numberFeatures)
+{
+    return fnv1a(rows, (size_t)numberMovies * numberFeatures * sizeof(Real));
+}
+
+
+/**
+ * @brief row length of a full matrix with room for inserted movies
+ * @param numberMovies: movies it holds
+ * @return stride
+ */
+static int denseStride(const int numberMovies)
+{
+    return numberMovies + std::max(MIN_SPARE, numberMovies / SPARE_FRACTION);
+}
+
+
+/**
+ * @brief similarities of one movie to every movie, as the exact CF scan computes them
+ * @param movieId: movie
+ * @param rows: row-major movie features
+ * @param norms: norm of every movie
+ * @param numberMovies: number of movies
+ * @param numberFeatures: features per movie
+ * @param similarities: filled with numberMovies similarities
+ */
+static void similarityRow(const int movieId, const Real* rows, const Real* norms, const int numberMovies,
+                          const int numberFeatures, Real* similarities)
+{
+    dotProducts(rows + ((size_t)movieId * numberFeatures), rows, numberMovies, numberFeatures, similarities);
+    for (int movie = 0; movie < numberMovies; movie++)
+    {
+        similarities[movie] = cosineSimilarity(similarities[movie], norms[movieId], norms[movie]);
+    }
+}
+
+
+/**
+ * @brief compute the cache
+ */
+void SimilarityCache::build(const Real* rows, const Real* norms, const int numberMovies, const int numberFeatures,
+                            const int topM, const int threads)
+{
+    clear();
+    _numberMovies = numberMovies;
+    _requestedTopM = std::max(0, topM);
+    _topM = std::min(_requestedTopM, numberMovies);
+    if (isDense())
+    {
+        _stride = denseStride(numberMovies);
+        _dense.resize((size_t)_stride * _stride);
+    }
+    else
+    {
+        _neighbourIds.resize((size_t)numberMovies * _topM);
+        _neighbourSimilarity.resize((size_t)numberMovies * _topM);
+    }
+
+    parallelFor(numberMovies, threads, [&](int begin, int end)
+    {
+        vector<Real> row(numberMovies);
+        vector<int> order(numberMovies);
+        for (int movie = begin; movie < end; movie++)
+        {
+            similarityRow(movie, rows, norms, numberMovies, numberFeatures, row.data());
+            if (isDense())
+            {
+                std::copy(row.begin(), row.end(), _dense.begin() + ((size_t)movie * _stride));
+                continue;
+            }
+            std::iota(order.begin(), order.end(), 0);
+            std::partial_sort(order.begin(), order.begin() + _topM, order.end(), [&row](int left, int right)
+            {
+                return (row[left] > row[right]) || ((row[left] == row[right]) && (left < right));
+            });
+            for (int rank = 0; rank < _topM; rank++)
+            {
+                _neighbourIds[((size_t)movie * _topM) + rank] = order[rank];
+                _neighbourSimilarity[((size_t)movie * _topM) + rank] = row[order[rank]];
+            }
+        }
+    });
+}
+
+
+/**
+ * @brief add a movie to the full matrix
+ * @param movieId: id of the new movie
+ * @param row: its similarity to every movie, the new one included
+ */
+void SimilarityCache::insertDense(const int movieId, const vector<Real>& row)
+{
+    int numberMovies = _numberMovies + 1;
+    if (numberMovies > _stride)
+    {
+        // out of spare room: one copy into a larger matrix, then the in place insertion below
+        int stride = denseStride(numberMovies);
+        vector<Real> dense((size_t)stride * stride);
+        for (int movie = 0; movie < _numberMovies; movie++)
+        {
+            std::copy(&_dense[(size_t)movie * _stride], &_dense[(size_t)movie * _stride] + _numberMovies,
+                      &dense[(size_t)movie * stride]);
+        }
+        _dense.swap(dense);
+        _stride = stride;
+    }
+
+    // rows and columns of later ids move by one, from the last so nothing is overwritten before it moved
+    for (int movie = _numberMovies - 1; movie >= 0; movie--)
+    {
+        Real* oldRow = &_dense[(size_t)movie * _stride];
+        Real* newRow = &_dense[(size_t)(movie + (movie >= movieId)) * _stride];
+        std::copy_backward(oldRow + movieId, oldRow + _numberMovies, newRow + numberMovies);
+        if (newRow != oldRow)
+        {
+            std::copy(oldRow, oldRow + movieId, newRow);
+        }
+        newRow[movieId] = row[movie + (movie >= movieId)];
+    }
+    std::copy(row.begin(), row.end(), &_dense[(size_t)movieId * _stride]);
+    _numberMovies = numberMovies;
+}
+
+
+/**
+ * @brief add a movie to the cache
+ */
+void SimilarityCache::insertMovie(const int movieId, const Real* rows, const Real* norms, const int numberFeatures)
+{
+    int numberMovies = _numberMovies + 1;
+    vector<Real> row(numberMovies);
+    similarityRow(movieId, rows, norms, numberMovies, numberFeatures, row.data());
+    if (isDense())
+    {
+        insertDense(movieId, row);
+        return;
+    }
+
+    // lists holding the whole catalogue because it was smaller than the requested M grow with it, as a rebuild's
+    // would; the others keep M neighbours
+    int topM = std::min(_requestedTopM, numberMovies);
+    if (topM > _topM)
+    {
+        vector<int> neighbourIds((size_t)_numberMovies * topM);
+        vector<Real> neighbourSimilarity((size_t)_numberMovies * topM);
+        for (int movie = 0; movie < _numberMovies; movie++)
+        {
+            std::copy(&_neighbourIds[(size_t)movie * _topM], &_neighbourIds[(size_t)(movie + 1) * _topM],
+                      &neighbourIds[(size_t)movie * topM]);
+            std::copy(&_neighbourSimilarity[(size_t)movie * _topM], &_neighbourSimilarity[(size_t)(movie + 1) * _topM],
+                      &neighbourSimilarity[(size_t)movie * topM]);
+        }
+        _neighbourIds.swap(neighbourIds);
+        _neighbourSimilarity.swap(neighbourSimilarity);
+    }
+    bool grown = topM > _topM;
+    _topM = topM;
+
+    // shift the ids after the new movie, then it takes the free last place of every grown list, or replaces the
+    // last neighbour of every movie it ranks before
+    for (int& _neighbour : _neighbourIds)
+    {
+        _neighbour += (_neighbour >= movieId);
+    }
+    for (int movie = 0; movie < _numberMovies; movie++)
+    {
+        int* ids = &_neighbourIds[(size_t)movie * _topM];
+        Real* similarity = &_neighbourSimilarity[(size_t)movie * _topM];
+        int other = movie + (movie >= movieId);
+        if (!grown &&
+            !scoredBefore(ScoredId(movieId, row[other]), ScoredId(ids[_topM - 1], similarity[_topM - 1])))
+        {
+            continue;
+        }
+        int rank = _topM - 1;
+        for (; (rank > 0) && scoredBefore(ScoredId(movieId, row[other]), ScoredId(ids[rank - 1], similarity[rank - 1]));
+             rank--)
+        {
+            ids[rank] = ids[rank - 1];
+            similarity[rank] = similarity[rank - 1];
+        }
+        ids[rank] = movieId;
+        similarity[rank] = row[other];
+    }
+
+    // the new movie's own list
+    vector<ScoredId> neighbours(numberMovies);
+    for (int other = 0; other < numberMovies; other++)
+    {
+        neighbours[other] = ScoredId(other, row[other]);
+    }
+    selectTopK(neighbours, _topM);
+    _neighbourIds.insert(_neighbourIds.begin() + ((size_t)movieId * _topM), _topM, 0);
+    _neighbourSimilarity.insert(_neighbourSimilarity.begin() + ((size_t)movieId * _topM), _topM, 0);
+    for (int rank = 0; rank < _topM; rank++)
+    {
+        _neighbourIds[((size_t)movieId * _topM) + rank] = neighbours[rank].first;
+        _neighbourSimilarity[((size_t)movieId * _topM) + rank] = neighbours[rank].second;
+    }
+    _numberMovies = numberMovies;
+}
+
+
+/**
+ * @brief write the cache
+ */
+bool SimilarityCache::save(const string& path, const Real* rows, const int numberFeatures) const
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    int header[SIMILARITY_HEADER_SIZE] = {SIMILARITY_VERSION, _numberMovies, _topM, (int)sizeof(Real),
+                                          _requestedTopM};
+    uint64_t checksum = featuresChecksum(rows, _numberMovies, numberFeatures);
+    file.write(SIMILARITY_MAGIC, SIMILARITY_MAGIC_SIZE);
+    file.write((const char*) header, sizeof(header));
+    file.write((const char*) &checksum, sizeof(checksum));
+    if (isDense())
+    {
+        for (int movie = 0; movie < _numberMovies; movie++)
+        {
+            file.write((const char*) &_dense[(size_t)movie * _stride], (size_t)_numberMovies * sizeof(Real));
+        }
+    }
+    else
+    {
+        file.write((const char*) _neighbourIds.data(), _neighbourIds.size() * sizeof(int));
+        file.write((const char*) _neighbourSimilarity.data(), _neighbourSimilarity.size() * sizeof(Real));
+    }
+    return file.good();
+}
+
+
+/**
+ * @brief read the cache
+ */
+bool SimilarityCache::load(const string& path, const Real* rows, const int numberMovies, const int numberFeatures)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    char magic[SIMILARITY_MAGIC_SIZE];
+    int header[SIMILARITY_HEADER_SIZE];
+    uint64_t checksum = 0;
+    file.read(magic, SIMILARITY_MAGIC_SIZE);
+    file.read((char*) header, sizeof(header));
+    file.read((char*) &checksum, sizeof(checksum));
+    if (!file.good() || (std::memcmp(magic, SIMILARITY_MAGIC, SIMILARITY_MAGIC_SIZE) != 0) ||
+        (header[0] != SIMILARITY_VERSION) || (header[1] != numberMovies) || (header[2] < 0) ||
+        (header[2] > numberMovies) || (header[3] != (int)sizeof(Real)) ||
+        (header[4] < header[2]) || ((header[2] < numberMovies) && (header[4] != header[2])) ||
+        (checksum != featuresChecksum(rows, numberMovies, numberFeatures)))
+    {
+        return false;
+    }
+
+    SimilarityCache loaded;
+    loaded._numberMovies = header[1];
+    loaded._topM = header[2];
+    loaded._requestedTopM = header[4];
+    if (loaded.isDense())
+    {
+        loaded._stride = denseStride(numberMovies);
+        loaded._dense.resize((size_t)loaded._stride * loaded._stride);
+        for (int movie = 0; movie < numberMovies; movie++)
+        {
+            file.read((char*) &loaded._dense[(size_t)movie * loaded._stride], (size_t)numberMovies * sizeof(Real));
+        }
+    }
+    else
+    {
+        loaded._neighbourIds.resize((size_t)numberMovies * loaded._topM);
+        loaded._neighbourSimilarity.resize((size_t)numberMovies * loaded._topM);
+        file.read((char*) loaded._neighbourIds.data(), loaded._neighbourIds.size() * sizeof(int));
+        file.read((char*) loaded._neighbourSimilarity.data(), loaded._neighbourSimilarity.size() * sizeof(Real));
+        for (const int neighbour : loaded._neighbourIds)
+        {
+            if ((neighbour < 0) || (neighbour >= numberMovies))
+            {
+                return false;
+            }
+        }
+    }
+    // a longer file was written for something else
+    if (!file.good() || (file.peek() != std::ifstream::traits_type::eof()))
+    {
+        return false;
+    }
+    *this = std::move(loaded);
+    return true;
+}
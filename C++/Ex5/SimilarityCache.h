@@ -0,0 +1,147 @@
+/**
+* @file SimilarityCache.h
+* @author  Jonathan Birnbaum
+* @date 18/06/2020
+*
+* @brief SimilarityCache class declaration and documentation
+*/
+
+#ifndef EX5_SIMILARITYCACHE_H
+#define EX5_SIMILARITYCACHE_H
+
+#include <string>
+#include <vector>
+#include "Real.h"
+
+using std::string;
+using std::vector;
+
+/**
+ * @brief precomputed item-item cosine similarities: the full matrix for small catalogues,
+ * or the top-M neighbours of every movie (most similar first) for large ones
+ */
+class SimilarityCache
+{
+    private:
+        int             _numberMovies;
+        int             _topM; // 0 for the full matrix
+        int             _requestedTopM; // topM of the build, above _topM when the catalogue was smaller
+        int             _stride; // row length of _dense, spare columns (and rows) take inserted movies
+        vector<Real>    _dense; // row-major (movie_id, movie_id) similarity, _stride x _stride
+        vector<int>     _neighbourIds; // _topM neighbour ids per movie, most similar first (lower id on ties)
+        vector<Real>    _neighbourSimilarity; // their similarity values
+
+        /**
+         * @brief add a movie to the full matrix
+         * @param movieId: id of the new movie, later ids were shifted up by one
+         * @param row: its similarity to every movie, the new one included
+         */
+        void insertDense(int movieId, const vector<Real>& row);
+
+    public:
+
+        /**
+         * @brief constructor - empty (disabled) cache
+         */
+        SimilarityCache() : _numberMovies(0), _topM(0), _requestedTopM(0), _stride(0) {}
+
+        /**
+         * @brief compute the cache in parallel
+         * @param rows: row-major movie features
+         * @param norms: norm of every movie
+         * @param numberMovies: number of movies
+         * @param numberFeatures: features per movie
+         * @param topM: neighbours kept per movie, 0 or less for the full matrix
+         * @param threads: number of threads, 0 or less for every hardware thread
+         */
+        void build(const Real* rows, const Real* norms, int numberMovies, int numberFeatures, int topM, int threads);
+
+        /**
+         * @brief add a movie to a built cache without recomputing the other rows: the full matrix fills its new row
+         * and column in place while it has spare capacity, moving only the rows and columns of later ids
+         * @param movieId: id of the new movie, later ids were shifted up by one
+         * @param rows: row-major features of every movie, the new one included
+         * @param norms: norm of every movie, the new one included
+         * @param numberFeatures: features per movie
+         */
+        void insertMovie(int movieId, const Real* rows, const Real* norms, int numberFeatures);
+
+        /**
+         * @brief drop the cache
+         */
+        void clear() {*this = SimilarityCache(); }
+
+        /**
+         * @brief check if the cache was built or loaded
+         * @return true if there are similarities to look up
+         */
+        bool isEmpty() const {return _numberMovies == 0; }
+
+        /**
+         * @brief check the cache kind
+         * @return true for the full matrix, false for top-M neighbour lists
+         */
+        bool isDense() const {return _topM == 0; }
+
+        /**
+         * @brief getter number of movies
+         * @return movies covered by the cache
+         */
+        int getNumberMovies() const {return _numberMovies; }
+
+        /**
+         * @brief getter neighbours per movie
+         * @return M of the top-M lists (0 for the full matrix)
+         */
+        int getTopM() const {return _topM; }
+
+        /**
+         * @brief similarity lookup in the full matrix
+         * @param movieId: first movie
+         * @param otherMovieId: second movie
+         * @return cosine similarity
+         */
+        Real similarity(int movieId, int otherMovieId) const
+        {
+            return _dense[((size_t)movieId * _stride) + otherMovieId];
+        }
+
+        /**
+         * @brief top-M neighbour ids of a movie
+         * @param movieId: movie
+         * @return pointer to getTopM() ids, most similar first
+         */
+        const int* neighbourIds(int movieId) const {return &_neighbourIds[(size_t)movieId * _topM]; }
+
+        /**
+         * @brief top-M neighbour similarities of a movie
+         * @param movieId: movie
+         * @return pointer to getTopM() similarities matching neighbourIds
+         */
+        const Real* neighbourSimilarity(int movieId) const
+        {
+            return &_neighbourSimilarity[(size_t)movieId * _topM];
+        }
+
+        /**
+         * @brief write the cache to a binary file, with a checksum of the features it was computed from
+         * @param path: file path
+         * @param rows: row-major features of every movie
+         * @param numberFeatures: features per movie
+         * @return true for success
+         */
+        bool save(const string& path, const Real* rows, int numberFeatures) const;
+
+        /**
+         * @brief read a cache written by save
+         * @param path: file path
+         * @param rows: row-major features of every movie, must be the ones the cache was saved with
+         * @param numberMovies: expected number of movies
+         * @param numberFeatures: features per movie
+         * @return true for success, false (cache unchanged) if missing, of another catalogue size or features,
+         * written by a build of another Real type, or with a neighbour id out of range or bytes past the end
+         */
+        bool load(const string& path, const Real* rows, int numberMovies, int numberFeatures);
+};
+
+#endif //EX5_SIMILARITYCACHE_H
@@ -0,0 +1,438 @@
+/**
+ * @file TextLoader.cpp
+ * @author  Jonathan Birnbaum
+ * @date 18/06/2020
+ *
+ * @brief parallel parsing of the features and rank text files
+ */
+
+#include "TextLoader.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <unordered_set>
+
+#define NO_RANK "NA"
+#define NO_RANK_SIZE (2)
+#define MIN_CHUNK_BYTES (1 << 16)
+#define FAST_PATH_DIGITS (15) // integers up to 10^15 are exact doubles
+#define FAST_PATH_EXPONENT (22) // 10^22 is the largest exact power of ten
+#define ERROR_MSG_FEATURES_COUNT "Invalid number of features for movie "
+#define ERROR_MSG_FEATURE_VALUE "Invalid feature of movie "
+#define ERROR_MSG_RANK_VALUE "Invalid rank of user "
+#define ERROR_MSG_DUPLICATE_FEATURES "Duplicate features of movie "
+#define ERROR_MSG_DUPLICATE_MOVIE "Duplicate movie in the rank file header "
+#define ERROR_MSG_DUPLICATE_USER "Duplicate rank row of user "
+
+static const double powersOfTen[FAST_PATH_EXPONENT + 1] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+                                                           1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19,
+                                                           1e20, 1e21, 1e22};
+
+/**
+ * @brief lines of one chunk of the features file
+ */
+class FeatureChunk
+{
+    public:
+        FeatureTable    _table;
+        vector<int>     _counts; // features per line
+        string          _error; // first invalid number of the chunk, lines after it are not parsed
+};
+
+/**
+ * @brief rows of one chunk of the rank file
+ */
+class RankChunk
+{
+    public:
+        RankTable       _table;
+        string          _error;
+};
+
+
+/**
+ * @brief whitespace between tokens ('\n' ends the line before reaching here)
+ * @param c: character
+ * @return true for a separator
+ */
+static inline bool isSeparator(const char c)
+{
+    return (c == ' ') || (c == '\t') || (c == '\r') || (c == '\v') || (c == '\f');
+}
+
+
+/**
+ * @brief find the next token of a line
+ * @param cursor: position in the line, moved past the token
+ * @param end: end of the line
+ * @param tokenBegin: filled with the first character of the token
+ * @return false when the line has no more tokens
+ */
+static inline bool nextToken(const char*& cursor, const char* end, const char*& tokenBegin)
+{
+    while ((cursor < end) && isSeparator(*cursor))
+    {
+        cursor++;
+    }
+    if (cursor == end)
+    {
+        return false;
+    }
+    tokenBegin = cursor;
+    while ((cursor < end) && !isSeparator(*cursor))
+    {
+        cursor++;
+    }
+    return true;
+}
+
+
+/**
+ * @brief parse a whole token as a double with strtod
+ * @param begin: first character
+ * @param end: past the last character
+ * @param value: filled with the number
+ * @return true if the token is a number
+ */
+static bool parseNumberSlow(const char* begin, const char* end, double& value)
+{
+    string token(begin, end);
+    char* parsedEnd = nullptr;
+    value = std::strtod(token.c_str(), &parsedEnd);
+    return (!token.empty()) && (parsedEnd == token.c_str() + token.size());
+}
+
+
+/**
+ * @brief parse a whole token as a double - plain decimals with few digits are converted exactly by one
+ * multiplication or division by a power of ten, anything else goes to strtod
+ * @param begin: first character
+ * @param end: past the last character
+ * @param value: filled with the number
+ * @return true if the token is a number
+ */
+static inline bool parseNumber(const char* begin, const char* end, double& value)
+{
+    const char* cursor = begin;
+    bool negative = false;
+    if ((cursor < end) && ((*cursor == '-') || (*cursor == '+')))
+    {
+        negative = (*cursor == '-');
+        cursor++;
+    }
+    uint64_t mantissa = 0;
+    int significantDigits = 0;
+    int exponent = 0;
+    bool anyDigit = false;
+    for (; (cursor < end) && (*cursor >= '0') && (*cursor <= '9'); cursor++)
+    {
+        mantissa = (mantissa * 10) + (*cursor - '0');
+        significantDigits += (mantissa != 0);
+        anyDigit = true;
+    }
+    if ((cursor < end) && (*cursor == '.'))
+    {
+        for (cursor++; (cursor < end) && (*cursor >= '0') && (*cursor <= '9'); cursor++)
+        {
+            mantissa = (mantissa * 10) + (*cursor - '0');
+            significantDigits += (mantissa != 0);
+            exponent--;
+            anyDigit = true;
+        }
+    }
+    if (anyDigit && (cursor < end) && ((*cursor == 'e') || (*cursor == 'E')))
+    {
+        const char* exponentCursor = cursor + 1;
+        bool negativeExponent = false;
+        if ((exponentCursor < end) && ((*exponentCursor == '-') || (*exponentCursor == '+')))
+        {
+            negativeExponent = (*exponentCursor == '-');
+            exponentCursor++;
+        }
+        int written = 0;
+        bool exponentDigit = false;
+        for (; (exponentCursor < end) && (*exponentCursor >= '0') && (*exponentCursor <= '9'); exponentCursor++)
+        {
+            written = std::min(written * 10 + (*exponentCursor - '0'), 1000000);
+            exponentDigit = true;
+        }
+        if (exponentDigit)
+        {
+            exponent += negativeExponent ? -written : written;
+            cursor = exponentCursor;
+        }
+    }
+    if (!anyDigit || (cursor != end) || (significantDigits > FAST_PATH_DIGITS) ||
+        (exponent < -FAST_PATH_EXPONENT) || (exponent > FAST_PATH_EXPONENT))
+    {
+        return parseNumberSlow(begin, end, value);
+    }
+    value = (exponent < 0) ? (double)mantissa / powersOfTen[-exponent] : (double)mantissa * powersOfTen[exponent];
+    value = negative ? -value : value;
+    return true;
+}
+
+
+/**
+ * @brief split [begin, size) into at most parts pieces that start right after a newline
+ * @param text: file content
+ * @param begin: offset of the first line
+ * @param size: content size
+ * @param threads: requested threads
+ * @return increasing offsets, first is begin and last is size
+ */
+static vector<size_t> splitAtLines(const char* text, const size_t begin, const size_t size, const int threads)
+{
+    size_t parts = std::min((size_t)resolveThreads(threads), std::max((size_t)1, (size - begin) / MIN_CHUNK_BYTES));
+    vector<size_t> bounds(1, begin);
+    for (size_t part = 1; part < parts; part++)
+    {
+        size_t offset = std::max(bounds.back(), begin + ((size - begin) * part) / parts);
+        const void* newline = std::memchr(text + offset, '\n', size - offset);
+        if (newline == nullptr)
+        {
+            break;
+        }
+        bounds.push_back((size_t)((const char*) newline - text) + 1);
+    }
+    bounds.push_back(size);
+    return bounds;
+}
+
+
+/**
+ * @brief call function(lineBegin, lineEnd) for every line of [begin, end) holding a token, until it returns false
+ * @param begin: first character
+ * @param end: past the last character
+ * @param function: callable on the line bounds (without the newline)
+ */
+template <class Function>
+static void forEachLine(const char* begin, const char* end, Function function)
+{
+    while (begin < end)
+    {
+        const char* newline = (const char*) std::memchr(begin, '\n', end - begin);
+        const char* lineEnd = (newline == nullptr) ? end : newline;
+        const char* cursor = begin;
+        const char* token;
+        if (nextToken(cursor, lineEnd, token) && !function(begin, lineEnd))
+        {
+            return;
+        }
+        begin = lineEnd + 1;
+    }
+}
+
+
+/**
+ * @brief parse the lines of a features chunk
+ * @param begin: first character
+ * @param end: past the last character
+ * @param chunk: filled with the lines
+ */
+static void parseFeatureChunk(const char* begin, const char* end, FeatureChunk& chunk)
+{
+    forEachLine(begin, end, [&](const char* cursor, const char* lineEnd) -> bool
+    {
+        const char* token;
+        nextToken(cursor, lineEnd, token);
+        chunk._table._movies.emplace_back(token, cursor);
+        int count = 0;
+        double rate;
+        while (nextToken(cursor, lineEnd, token))
+        {
+            if (!parseNumber(token, cursor, rate))
+            {
+                chunk._error = ERROR_MSG_FEATURE_VALUE + chunk._table._movies.back();
+                chunk._table._movies.pop_back();
+                chunk._table._rates.resize(chunk._table._rates.size() - count);
+                return false;
+            }
+            chunk._table._rates.push_back((Real) rate);
+            count++;
+        }
+        chunk._counts.push_back(count);
+        return true;
+    });
+}
+
+
+/**
+ * @brief parse the user rows of a rank chunk
+ * @param begin: first character
+ * @param end: past the last character
+ * @param numberMovies: header size, later entries are ignored
+ * @param chunk: filled with the rows
+ */
+static void parseRankChunk(const char* begin, const char* end, const int numberMovies, RankChunk& chunk)
+{
+    RankTable& table = chunk._table;
+    table._rowStart.assign(1, 0);
+    forEachLine(begin, end, [&](const char* cursor, const char* lineEnd) -> bool
+    {
+        const char* token;
+        nextToken(cursor, lineEnd, token);
+        table._users.emplace_back(token, cursor);
+        double rate;
+        for (int column = 0; (column < numberMovies) && nextToken(cursor, lineEnd, token); column++)
+        {
+            if (((cursor - token) == NO_RANK_SIZE) && (std::memcmp(token, NO_RANK, NO_RANK_SIZE) == 0))
+            {
+                continue;
+            }
+            if (!parseNumber(token, cursor, rate))
+            {
+                chunk._error = ERROR_MSG_RANK_VALUE + table._users.back();
+                table._users.pop_back();
+                table._columns.resize(table._rowStart.back());
+                table._rates.resize(table._rowStart.back());
+                return false;
+            }
+            table._columns.push_back(column);
+            table._rates.push_back((Real) rate);
+        }
+        table._rowStart.push_back(table._columns.size());
+        return true;
+    });
+}
+
+
+/**
+ * @brief find a name given more than once
+ * @param names: names to check
+ * @param duplicate: filled with the first name seen again
+ * @return true if there is one
+ */
+static bool findDuplicate(const vector<string>& names, string& duplicate)
+{
+    std::unordered_set<string> seen;
+    seen.reserve(names.size());
+    for (const string& _name : names)
+    {
+        if (!seen.insert(_name).second)
+        {
+            duplicate = _name;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+ * @brief parse a features file
+ */
+bool parseFeatures(const char* text, const size_t size, const int threads, FeatureTable& table, string& error)
+{
+    vector<size_t> bounds = splitAtLines(text, 0, size, threads);
+    vector<FeatureChunk> chunks(bounds.size() - 1);
+    parallelFor((int)chunks.size(), (int)chunks.size(), [&](int begin, int end)
+    {
+        for (int chunk = begin; chunk < end; chunk++)
+        {
+            parseFeatureChunk(text + bounds[chunk], text + bounds[chunk + 1], chunks[chunk]);
+        }
+    });
+
+    // chunks after the first invalid number are dropped, so a count mismatch found below comes before it
+    table = FeatureTable();
+    error.clear();
+    bool first = true;
+    for (FeatureChunk& chunk : chunks)
+    {
+        for (size_t line = 0; line < chunk._counts.size(); line++)
+        {
+            if (first)
+            {
+                table._numberFeatures = chunk._counts[line];
+                first = false;
+            }
+            else if (chunk._counts[line] != table._numberFeatures)
+            {
+                error = ERROR_MSG_FEATURES_COUNT + chunk._table._movies[line];
+                return false;
+            }
+        }
+        table._movies.insert(table._movies.end(), std::make_move_iterator(chunk._table._movies.begin()),
+                             std::make_move_iterator(chunk._table._movies.end()));
+        table._rates.insert(table._rates.end(), chunk._table._rates.begin(), chunk._table._rates.end());
+        if (!chunk._error.empty())
+        {
+            error = chunk._error;
+            return false;
+        }
+    }
+    // a movie has one feature row, a second one would be written over it
+    string duplicate;
+    if (findDuplicate(table._movies, duplicate))
+    {
+        error = ERROR_MSG_DUPLICATE_FEATURES + duplicate;
+        return false;
+    }
+    return true;
+}
+
+
+/**
+ * @brief parse a rank file
+ */
+bool parseRanks(const char* text, const size_t size, const int threads, RankTable& table, string& error)
+{
+    table = RankTable();
+    error.clear();
+    const char* headerEnd = (size == 0) ? text : (const char*) std::memchr(text, '\n', size);
+    headerEnd = (headerEnd == nullptr) ? text + size : headerEnd;
+    const char* cursor = text;
+    const char* token;
+    while (nextToken(cursor, headerEnd, token))
+    {
+        table._movies.emplace_back(token, cursor);
+    }
+    string duplicate;
+    if (findDuplicate(table._movies, duplicate))
+    {
+        error = ERROR_MSG_DUPLICATE_MOVIE + duplicate;
+        return false;
+    }
+    size_t bodyBegin = std::min(size, (size_t)(headerEnd - text) + 1);
+
+    vector<size_t> bounds = splitAtLines(text, bodyBegin, size, threads);
+    vector<RankChunk> chunks(bounds.size() - 1);
+    parallelFor((int)chunks.size(), (int)chunks.size(), [&](int begin, int end)
+    {
+        for (int chunk = begin; chunk < end; chunk++)
+        {
+            parseRankChunk(text + bounds[chunk], text + bounds[chunk + 1], (int)table._movies.size(),
+                           chunks[chunk]);
+        }
+    });
+
+    table._rowStart.assign(1, 0);
+    for (RankChunk& chunk : chunks)
+    {
+        size_t offset = table._columns.size();
+        for (size_t row = 1; row < chunk._table._rowStart.size(); row++)
+        {
+            table._rowStart.push_back(offset + chunk._table._rowStart[row]);
+        }
+        table._users.insert(table._users.end(), std::make_move_iterator(chunk._table._users.begin()),
+                            std::make_move_iterator(chunk._table._users.end()));
+        table._columns.insert(table._columns.end(), chunk._table._columns.begin(), chunk._table._columns.end());
+        table._rates.insert(table._rates.end(), chunk._table._rates.begin(), chunk._table._rates.end());
+        if (!chunk._error.empty())
+        {
+            error = chunk._error;
+            return false;
+        }
+    }
+    // a name maps to one user, so a second row of the same name would be unreachable
+    if (findDuplicate(table._users, duplicate))
+    {
+        error = ERROR_MSG_DUPLICATE_USER + duplicate;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,67 @@
+/**
+* @file TextLoader.h
+* @author  Jonathan Birnbaum
+* @date 18/06/2020
+*
+* @brief parallel parsing of the features and rank text files
+*/
+
+#ifndef EX5_TEXTLOADER_H
+#define EX5_TEXTLOADER_H
+
+#include <string>
+#include <vector>
+#include "Real.h"
+
+using std::string;
+using std::vector;
+
+/**
+ * @brief parsed features file, in file order
+ */
+class FeatureTable
+{
+    public:
+        vector<string>  _movies; // movie name per line
+        vector<Real>    _rates; // row-major (line, feature) rates
+        int             _numberFeatures = 0;
+};
+
+/**
+ * @brief parsed rank file: header movies and the rated (not NA) entries of every user row
+ */
+class RankTable
+{
+    public:
+        vector<string>  _movies; // header, column order
+        vector<string>  _users; // user name per row
+        vector<size_t>  _rowStart; // _users.size() + 1 offsets into _columns / _rates
+        vector<int>     _columns; // column of each rated entry, ascending within a row
+        vector<Real>    _rates; // rate of each rated entry
+};
+
+/**
+ * @brief parse a features file ("movie rate rate ..." per line), a movie given two lines is an error
+ * @param text: file content
+ * @param size: content size
+ * @param threads: number of threads, 0 for every hardware thread
+ * @param table: filled with the parsed lines
+ * @param error: filled with a message on failure
+ * @return true for success
+ */
+bool parseFeatures(const char* text, size_t size, int threads, FeatureTable& table, string& error);
+
+/**
+ * @brief parse a rank file (header of movie names, then "user rate|NA ..." per line)
+ * missing trailing entries of a row count as NA, entries beyond the header are ignored. A movie given twice in the
+ * header or a user given two rows is an error
+ * @param text: file content
+ * @param size: content size
+ * @param threads: number of threads, 0 for every hardware thread
+ * @param table: filled with the header and the rated entries
+ * @param error: filled with a message on failure
+ * @return true for success
+ */
+bool parseRanks(const char* text, size_t size, int threads, RankTable& table, string& error);
+
+#endif //EX5_TEXTLOADER_H
@@ -0,0 +1,125 @@
+/**
+* @file TopK.h
+* @author  Jonathan Birnbaum
+* @date 18/06/2020
+*
+* @brief top-k selection over flat (id, score) arrays
+*/
+
+#ifndef EX5_TOPK_H
+#define EX5_TOPK_H
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief (id, score) pair - ids are interned movie ids (or positions in id order)
+ */
+typedef std::pair<int, double> ScoredId;
+
+/**
+ * @brief ranking order: higher score first, lower id on ties (the rank file column order), NaN scores after every
+ * number - a strict weak order for any scores
+ * @param left: first pair
+ * @param right: second pair
+ * @return true if left ranks before right
+ */
+inline bool scoredBefore(const ScoredId& left, const ScoredId& right)
+{
+    bool leftNumber = (left.second == left.second);
+    if (leftNumber != (right.second == right.second))
+    {
+        return leftNumber;
+    }
+    return (left.second > right.second) ||
+           ((!leftNumber || (left.second == right.second)) && (left.first < right.first));
+}
+
+/**
+ * @brief keep only the k best pairs, ranked - O(n + k log k)
+ * @param items: pairs to select from, left with min(k, n) pairs in ranking order
+ * @param k: number of pairs to keep
+ */
+inline void selectTopK(std::vector<ScoredId>& items, int k)
+{
+    if (k < 0)
+    {
+        k = 0;
+    }
+    if ((k == 1) && !items.empty())
+    {
+        items[0] = *std::min_element(items.begin(), items.end(), scoredBefore);
+        items.resize(1);
+        return;
+    }
+    if (k < (int)items.size())
+    {
+        std::nth_element(items.begin(), items.begin() + k, items.end(), scoredBefore);
+        items.resize(k);
+    }
+    std::sort(items.begin(), items.end(), scoredBefore);
+}
+
+/**
+ * @brief the n best pairs of a stream, in a heap whose top is the worst kept pair - O(log n) per pushed pair
+ */
+class TopNHeap
+{
+    private:
+        std::vector<ScoredId>   _items;
+        int                     _n;
+
+    public:
+
+        /**
+         * @brief constructor - the storage grows with the pushed pairs, n may be far above their number
+         * @param n: number of pairs to keep
+         */
+        explicit TopNHeap(const int n) : _n(std::max(0, n)) {}
+
+        /**
+         * @brief offer a pair
+         * @param id: movie id
+         * @param score: its score
+         */
+        void push(const int id, const double score)
+        {
+            ScoredId item(id, score);
+            if ((int)_items.size() < _n)
+            {
+                _items.push_back(item);
+                std::push_heap(_items.begin(), _items.end(), scoredBefore);
+            }
+            else if ((_n > 0) && scoredBefore(item, _items.front()))
+            {
+                std::pop_heap(_items.begin(), _items.end(), scoredBefore);
+                _items.back() = item;
+                std::push_heap(_items.begin(), _items.end(), scoredBefore);
+            }
+        }
+
+        /**
+         * @brief check if a pair has to rank before the worst kept one to be kept
+         * @return true once n pairs are kept
+         */
+        bool isFull() const {return (_n > 0) && ((int)_items.size() == _n); }
+
+        /**
+         * @brief getter worst kept pair
+         * @return the pair a new one has to rank before, only when isFull
+         */
+        const ScoredId& worst() const {return _items.front(); }
+
+        /**
+         * @brief the kept pairs, emptying the heap
+         * @return at most n pairs in ranking order
+         */
+        std::vector<ScoredId> take()
+        {
+            std::sort_heap(_items.begin(), _items.end(), scoredBefore);
+            return std::move(_items);
+        }
+};
+
+#endif //EX5_TOPK_H
@@ -0,0 +1,113 @@
+/**
+ * @file TopKBenchmark.cpp
+ * @author  Jonathan Birnbaum
+ * @date 18/06/2020
+ *
+ * @brief benchmark of the CF top-k selection: k against user history length
+ */
+
+#include "TopK.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+#define BENCHMARK_REPEATS (50)
+#define BENCHMARK_SEED (1)
+
+static const int historyLengths[] = {10, 100, 1000, 10000};
+static const int kValues[] = {1, 5, 20, 100};
+
+
+/**
+ * @brief the selection used before: k full scans taking the maximum and removing it
+ * @param items: pairs to select from, left with the k best in ranking order
+ * @param k: number of pairs to keep
+ */
+static void selectByScans(std::vector<ScoredId>& items, int k)
+{
+    std::vector<ScoredId> selected;
+    int remaining = (int)items.size();
+    for (int i = 0; (i < k) && (remaining > 0); i++)
+    {
+        int maxIndex = 0;
+        for (int index = 1; index < remaining; index++)
+        {
+            if (scoredBefore(items[index], items[maxIndex]))
+            {
+                maxIndex = index;
+            }
+        }
+        selected.push_back(items[maxIndex]);
+        items[maxIndex] = items[--remaining];
+    }
+    items.swap(selected);
+}
+
+
+/**
+ * @brief random similarities of a user history
+ * @param history: number of seen movies
+ * @param generator: random generator
+ * @return (seen index, similarity) pairs
+ */
+static std::vector<ScoredId> randomHistory(int history, std::mt19937& generator)
+{
+    std::uniform_real_distribution<double> similarity(-1, 1);
+    std::vector<ScoredId> items(history);
+    for (int index = 0; index < history; index++)
+    {
+        items[index] = ScoredId(index, similarity(generator));
+    }
+    return items;
+}
+
+
+/**
+ * @brief average time of a selection function, each repeat on a fresh copy of the same input
+ * @param select: selection to time
+ * @param original: pairs to select from
+ * @param k: number of neighbours
+ * @param selected: filled with the selection's result
+ * @return microseconds per selection
+ */
+template <class Select>
+static double timeSelection(Select select, const std::vector<ScoredId>& original, int k,
+                            std::vector<ScoredId>& selected)
+{
+    double total = 0;
+    for (int repeat = 0; repeat < BENCHMARK_REPEATS; repeat++)
+    {
+        selected = original;
+        auto start = std::chrono::steady_clock::now();
+        select(selected, k);
+        std::chrono::duration<double, std::micro> time = std::chrono::steady_clock::now() - start;
+        total += time.count();
+    }
+    return total / BENCHMARK_REPEATS;
+}
+
+
+int main()
+{
+    std::mt19937 generator(BENCHMARK_SEED);
+    printf("%8s %5s %12s %12s %8s\n", "history", "k", "scans[us]", "topk[us]", "speedup");
+    for (int history : historyLengths)
+    {
+        // both selections run on the same input, so the times compare the algorithms and not the data
+        std::vector<ScoredId> original = randomHistory(history, generator);
+        for (int k : kValues)
+        {
+            if (k > history)
+            {
+                continue;
+            }
+            std::vector<ScoredId> byScans;
+            std::vector<ScoredId> byTopK;
+            double scans = timeSelection(selectByScans, original, k, byScans);
+            double topK = timeSelection(selectTopK, original, k, byTopK);
+            printf("%8d %5d %12.2f %12.2f %8.1f%s\n", history, k, scans, topK, scans / topK,
+                   (byScans == byTopK) ? "" : " (selections differ)");
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,147 @@
+/**
+ * @file UnixSocket.cpp
+ * @author  Jonathan Birnbaum
+ * @date 18/06/2020
+ *
+ * @brief line based Unix domain stream sockets
+ */
+
+#include "UnixSocket.h"
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define LISTEN_BACKLOG (128)
+#define READ_CHUNK (4096)
+
+
+/**
+ * @brief socket address of a path
+ * @param path: socket file path
+ * @param address: filled address
+ * @return false if the path doesn't fit sun_path
+ */
+static bool unixAddress(const string& path, sockaddr_un& address)
+{
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        return false;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size());
+    return true;
+}
+
+
+/**
+ * @brief bind and listen on a socket file
+ * @param path: socket file path
+ * @return listening descriptor, -1 on failure
+ */
+int listenUnixSocket(const string& path)
+{
+    sockaddr_un address;
+    if (!unixAddress(path, address))
+    {
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    unlink(path.c_str());
+    if ((bind(fd, (const sockaddr*) &address, sizeof(address)) != 0) || (listen(fd, LISTEN_BACKLOG) != 0))
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+
+/**
+ * @brief connect to a socket file
+ * @param path: socket file path
+ * @return connected descriptor, -1 on failure
+ */
+int connectUnixSocket(const string& path)
+{
+    sockaddr_un address;
+    if (!unixAddress(path, address))
+    {
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    if (connect(fd, (const sockaddr*) &address, sizeof(address)) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+
+/**
+ * @brief read the next line
+ * @param line: filled with the line
+ * @return false at end of stream or on error
+ */
+bool LineReader::readLine(string& line)
+{
+    size_t newline = _buffer.find('\n');
+    char chunk[READ_CHUNK];
+    while (newline == string::npos)
+    {
+        ssize_t bytes = read(_fd, chunk, sizeof(chunk));
+        if ((bytes < 0) && (errno == EINTR))
+        {
+            continue;
+        }
+        if (bytes <= 0)
+        {
+            return false;
+        }
+        size_t searched = _buffer.size();
+        _buffer.append(chunk, (size_t)bytes);
+        newline = _buffer.find('\n', searched);
+    }
+    line.assign(_buffer, 0, newline);
+    _buffer.erase(0, newline + 1);
+    return true;
+}
+
+
+/**
+ * @brief write a line and its newline
+ * @param fd: descriptor to write
+ * @param line: line without newline
+ * @return true for success
+ */
+bool writeLine(const int fd, const string& line)
+{
+    string message = line + '\n';
+    size_t written = 0;
+    while (written < message.size())
+    {
+        // MSG_NOSIGNAL: a closed peer is a failed write, not a SIGPIPE
+        ssize_t bytes = send(fd, message.data() + written, message.size() - written, MSG_NOSIGNAL);
+        if ((bytes < 0) && (errno == EINTR))
+        {
+            continue;
+        }
+        if (bytes <= 0)
+        {
+            return false;
+        }
+        written += (size_t)bytes;
+    }
+    return true;
+}
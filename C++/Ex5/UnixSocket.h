@@ -0,0 +1,63 @@
+/**
+* @file UnixSocket.h
+* @author  Jonathan Birnbaum
+* @date 18/06/2020
+*
+* @brief line based Unix domain stream sockets
+*/
+
+#ifndef EX5_UNIXSOCKET_H
+#define EX5_UNIXSOCKET_H
+
+#include <string>
+
+using std::string;
+
+/**
+ * @brief bind and listen on a socket file, replacing a stale one
+ * @param path: socket file path
+ * @return listening descriptor, -1 on failure
+ */
+int listenUnixSocket(const string& path);
+
+/**
+ * @brief connect to a listening socket file
+ * @param path: socket file path
+ * @return connected descriptor, -1 on failure
+ */
+int connectUnixSocket(const string& path);
+
+/**
+ * @brief buffered reader of newline terminated lines from a descriptor
+ */
+class LineReader
+{
+    private:
+        int     _fd;
+        string  _buffer; // bytes read past the last returned line
+
+    public:
+
+        /**
+         * @brief constructor
+         * @param fd: descriptor to read
+         */
+        explicit LineReader(const int fd) : _fd(fd) {}
+
+        /**
+         * @brief read the next line
+         * @param line: filled with the line, without the newline
+         * @return false at end of stream or on error
+         */
+        bool readLine(string& line);
+};
+
+/**
+ * @brief write a line and its newline
+ * @param fd: descriptor to write
+ * @param line: line without newline
+ * @return true for success
+ */
+bool writeLine(int fd, const string& line);
+
+#endif //EX5_UNIXSOCKET_H
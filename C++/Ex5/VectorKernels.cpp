@@ -0,0 +1,454 @@
+/**
+ * @file VectorKernels.cpp
+ * @author  Jonathan Birnbaum
+ * @date 18/06/2020
+ *
+ * @brief dot product and norm kernels with run time instruction set dispatch
+ */
+
+#include "VectorKernels.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define VECTOR_KERNELS_AVX2
+#include <immintrin.h>
+#endif
+
+#define ROWS_PER_BLOCK (4)
+#define VECS_PER_BLOCK (2) // 2 vectors x 4 rows = 8 accumulators, with the loads within the 16 AVX registers
+#define MATRIX_BLOCK_BYTES (32 * 1024) // slice of rows reused by every vector, about an L1 data cache
+
+/**
+ * @brief the kernels of one value type
+ */
+template <class T>
+struct KernelTable
+{
+    T (*dot)(const T*, const T*, int);
+    void (*dotRows)(const T*, const T*, int, int, T*);
+    void (*dotTile)(const T*, int, const T*, int, int, T*, int);
+};
+
+
+/**
+ * @brief portable dot product, 4 accumulators so the additions don't wait on each other (dotRowsScalar calls
+ * it, so batched and single results are equal)
+ */
+template <class T>
+static T dotScalar(const T* leftVec, const T* rightVec, const int vectorSize)
+{
+    T sums[4] = {0, 0, 0, 0};
+    int index = 0;
+    for (; index + 4 <= vectorSize; index += 4)
+    {
+        sums[0] += leftVec[index] * rightVec[index];
+        sums[1] += leftVec[index + 1] * rightVec[index + 1];
+        sums[2] += leftVec[index + 2] * rightVec[index + 2];
+        sums[3] += leftVec[index + 3] * rightVec[index + 3];
+    }
+    for (; index < vectorSize; index++)
+    {
+        sums[0] += leftVec[index] * rightVec[index];
+    }
+    return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+}
+
+
+/**
+ * @brief portable dot products against rows
+ */
+template <class T>
+static void dotRowsScalar(const T* vec, const T* rows, const int numberRows, const int vectorSize, T* results)
+{
+    for (int row = 0; row < numberRows; row++)
+    {
+        results[row] = dotScalar(vec, rows + ((long)row * vectorSize), vectorSize);
+    }
+}
+
+
+/**
+ * @brief portable products of some vectors against a slice of rows
+ */
+template <class T>
+static void dotTileScalar(const T* vecs, const int numberVecs, const T* rows, const int numberRows,
+                          const int vectorSize, T* results, const int resultsStride)
+{
+    for (int vec = 0; vec < numberVecs; vec++)
+    {
+        dotRowsScalar(vecs + ((long)vec * vectorSize), rows, numberRows, vectorSize,
+                      results + ((long)vec * resultsStride));
+    }
+}
+
+
+#ifdef VECTOR_KERNELS_AVX2
+
+/**
+ * @brief AVX2 lanes of 4 doubles
+ */
+struct DoubleLanes
+{
+    typedef double  Value;
+    typedef __m256d Lanes;
+    static const int width = 4;
+
+    __attribute__((target("avx2,fma"))) static inline Lanes zero() {return _mm256_setzero_pd(); }
+
+    __attribute__((target("avx2,fma"))) static inline Lanes load(const double* values)
+    {
+        return _mm256_loadu_pd(values);
+    }
+
+    /**
+     * @brief load the first remaining values (1 to 4) zero padded - the tail is summed by the lanes like the rest,
+     * so no kernel leaves a scalar tail to the compiler's choice of contraction
+     */
+    __attribute__((target("avx2,fma"))) static inline Lanes loadTail(const double* values, const int remaining)
+    {
+        __m256i mask = _mm256_cmpgt_epi64(_mm256_set1_epi64x(remaining), _mm256_setr_epi64x(0, 1, 2, 3));
+        return _mm256_maskload_pd(values, mask);
+    }
+
+    __attribute__((target("avx2,fma"))) static inline Lanes fmadd(const Lanes left, const Lanes right,
+                                                                  const Lanes sums)
+    {
+        return _mm256_fmadd_pd(left, right, sums);
+    }
+
+    /**
+     * @brief sum of the 4 lanes
+     */
+    __attribute__((target("avx2,fma"))) static inline double sum(const Lanes sums)
+    {
+        __m128d pair = _mm_add_pd(_mm256_castpd256_pd128(sums), _mm256_extractf128_pd(sums, 1));
+        return _mm_cvtsd_f64(_mm_add_sd(pair, _mm_unpackhi_pd(pair, pair)));
+    }
+};
+
+
+/**
+ * @brief AVX2 lanes of 8 floats
+ */
+struct FloatLanes
+{
+    typedef float   Value;
+    typedef __m256  Lanes;
+    static const int width = 8;
+
+    __attribute__((target("avx2,fma"))) static inline Lanes zero() {return _mm256_setzero_ps(); }
+
+    __attribute__((target("avx2,fma"))) static inline Lanes load(const float* values)
+    {
+        return _mm256_loadu_ps(values);
+    }
+
+    /**
+     * @brief load the first remaining values (1 to 8) zero padded
+     */
+    __attribute__((target("avx2,fma"))) static inline Lanes loadTail(const float* values, const int remaining)
+    {
+        __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(remaining), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        return _mm256_maskload_ps(values, mask);
+    }
+
+    __attribute__((target("avx2,fma"))) static inline Lanes fmadd(const Lanes left, const Lanes right,
+                                                                  const Lanes sums)
+    {
+        return _mm256_fmadd_ps(left, right, sums);
+    }
+
+    /**
+     * @brief sum of the 8 lanes
+     */
+    __attribute__((target("avx2,fma"))) static inline float sum(const Lanes sums)
+    {
+        __m128 quad = _mm_add_ps(_mm256_castps256_ps128(sums), _mm256_extractf128_ps(sums, 1));
+        __m128 pair = _mm_add_ps(quad, _mm_movehl_ps(quad, quad));
+        return _mm_cvtss_f32(_mm_add_ss(pair, _mm_shuffle_ps(pair, pair, 1)));
+    }
+};
+
+
+/**
+ * @brief AVX2 dot product - one accumulator of lanes, the same summation order as every row of dotRowsAvx2,
+ * so a batched result equals the single one bit for bit
+ */
+template <class L>
+__attribute__((target("avx2,fma"))) static typename L::Value dotAvx2(const typename L::Value* leftVec,
+                                                                     const typename L::Value* rightVec,
+                                                                     const int vectorSize)
+{
+    typename L::Lanes sums = L::zero();
+    int index = 0;
+    for (; index + L::width <= vectorSize; index += L::width)
+    {
+        sums = L::fmadd(L::load(rightVec + index), L::load(leftVec + index), sums);
+    }
+    if (index < vectorSize)
+    {
+        sums = L::fmadd(L::loadTail(rightVec + index, vectorSize - index),
+                        L::loadTail(leftVec + index, vectorSize - index), sums);
+    }
+    return L::sum(sums);
+}
+
+
+/**
+ * @brief AVX2 dot products, 4 rows at a time so every load of the vector is used 4 times
+ */
+template <class L>
+__attribute__((target("avx2,fma"))) static void dotRowsAvx2(const typename L::Value* vec,
+                                                            const typename L::Value* rows, const int numberRows,
+                                                            const int vectorSize, typename L::Value* results)
+{
+    typedef typename L::Value T;
+    int row = 0;
+    for (; row + ROWS_PER_BLOCK <= numberRows; row += ROWS_PER_BLOCK)
+    {
+        const T* row0 = rows + ((long)row * vectorSize);
+        const T* row1 = row0 + vectorSize;
+        const T* row2 = row1 + vectorSize;
+        const T* row3 = row2 + vectorSize;
+        typename L::Lanes sums0 = L::zero();
+        typename L::Lanes sums1 = L::zero();
+        typename L::Lanes sums2 = L::zero();
+        typename L::Lanes sums3 = L::zero();
+        int index = 0;
+        for (; index + L::width <= vectorSize; index += L::width)
+        {
+            typename L::Lanes values = L::load(vec + index);
+            sums0 = L::fmadd(L::load(row0 + index), values, sums0);
+            sums1 = L::fmadd(L::load(row1 + index), values, sums1);
+            sums2 = L::fmadd(L::load(row2 + index), values, sums2);
+            sums3 = L::fmadd(L::load(row3 + index), values, sums3);
+        }
+        if (index < vectorSize)
+        {
+            int remaining = vectorSize - index;
+            typename L::Lanes values = L::loadTail(vec + index, remaining);
+            sums0 = L::fmadd(L::loadTail(row0 + index, remaining), values, sums0);
+            sums1 = L::fmadd(L::loadTail(row1 + index, remaining), values, sums1);
+            sums2 = L::fmadd(L::loadTail(row2 + index, remaining), values, sums2);
+            sums3 = L::fmadd(L::loadTail(row3 + index, remaining), values, sums3);
+        }
+        results[row] = L::sum(sums0);
+        results[row + 1] = L::sum(sums1);
+        results[row + 2] = L::sum(sums2);
+        results[row + 3] = L::sum(sums3);
+    }
+    for (; row < numberRows; row++)
+    {
+        results[row] = dotAvx2<L>(vec, rows + ((long)row * vectorSize), vectorSize);
+    }
+}
+
+
+
+/**
+ * @brief AVX2 products of some vectors against a slice of rows, 2 vectors x 4 rows at a time so every load feeds
+ * 2 or 4 multiplications; each product keeps the dotAvx2 summation order
+ */
+template <class L>
+__attribute__((target("avx2,fma"))) static void dotTileAvx2(const typename L::Value* vecs, const int numberVecs,
+                                                            const typename L::Value* rows, const int numberRows,
+                                                            const int vectorSize, typename L::Value* results,
+                                                            const int resultsStride)
+{
+    typedef typename L::Value T;
+    int vec = 0;
+    for (; vec + VECS_PER_BLOCK <= numberVecs; vec += VECS_PER_BLOCK)
+    {
+        const T* vec0 = vecs + ((long)vec * vectorSize);
+        const T* vec1 = vec0 + vectorSize;
+        T* results0 = results + ((long)vec * resultsStride);
+        T* results1 = results0 + resultsStride;
+        int row = 0;
+        for (; row + ROWS_PER_BLOCK <= numberRows; row += ROWS_PER_BLOCK)
+        {
+            const T* row0 = rows + ((long)row * vectorSize);
+            const T* row1 = row0 + vectorSize;
+            const T* row2 = row1 + vectorSize;
+            const T* row3 = row2 + vectorSize;
+            typename L::Lanes sums00 = L::zero();
+            typename L::Lanes sums01 = L::zero();
+            typename L::Lanes sums02 = L::zero();
+            typename L::Lanes sums03 = L::zero();
+            typename L::Lanes sums10 = L::zero();
+            typename L::Lanes sums11 = L::zero();
+            typename L::Lanes sums12 = L::zero();
+            typename L::Lanes sums13 = L::zero();
+            for (int index = 0; index < vectorSize; index += L::width)
+            {
+                // the last step loads the tail zero padded
+                int remaining = std::min((int)L::width, vectorSize - index);
+                typename L::Lanes values0 = L::loadTail(vec0 + index, remaining);
+                typename L::Lanes values1 = L::loadTail(vec1 + index, remaining);
+                typename L::Lanes rowValues = L::loadTail(row0 + index, remaining);
+                sums00 = L::fmadd(rowValues, values0, sums00);
+                sums10 = L::fmadd(rowValues, values1, sums10);
+                rowValues = L::loadTail(row1 + index, remaining);
+                sums01 = L::fmadd(rowValues, values0, sums01);
+                sums11 = L::fmadd(rowValues, values1, sums11);
+                rowValues = L::loadTail(row2 + index, remaining);
+                sums02 = L::fmadd(rowValues, values0, sums02);
+                sums12 = L::fmadd(rowValues, values1, sums12);
+                rowValues = L::loadTail(row3 + index, remaining);
+                sums03 = L::fmadd(rowValues, values0, sums03);
+                sums13 = L::fmadd(rowValues, values1, sums13);
+            }
+            results0[row] = L::sum(sums00);
+            results0[row + 1] = L::sum(sums01);
+            results0[row + 2] = L::sum(sums02);
+            results0[row + 3] = L::sum(sums03);
+            results1[row] = L::sum(sums10);
+            results1[row + 1] = L::sum(sums11);
+            results1[row + 2] = L::sum(sums12);
+            results1[row + 3] = L::sum(sums13);
+        }
+        for (; row < numberRows; row++)
+        {
+            results0[row] = dotAvx2<L>(vec0, rows + ((long)row * vectorSize), vectorSize);
+            results1[row] = dotAvx2<L>(vec1, rows + ((long)row * vectorSize), vectorSize);
+        }
+    }
+    for (; vec < numberVecs; vec++)
+    {
+        dotRowsAvx2<L>(vecs + ((long)vec * vectorSize), rows, numberRows, vectorSize,
+                       results + ((long)vec * resultsStride));
+    }
+}
+
+#endif
+
+
+/**
+ * @brief check once which kernels the CPU can run
+ * @return true for AVX2 with FMA
+ */
+static bool supportsAvx2()
+{
+#ifdef VECTOR_KERNELS_AVX2
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+    return false;
+#endif
+}
+
+static const bool useAvx2 = supportsAvx2();
+static const KernelTable<double> scalarDoubleKernels = {dotScalar<double>, dotRowsScalar<double>,
+                                                        dotTileScalar<double>};
+static const KernelTable<float> scalarFloatKernels = {dotScalar<float>, dotRowsScalar<float>, dotTileScalar<float>};
+#ifdef VECTOR_KERNELS_AVX2
+static const KernelTable<double> avx2DoubleKernels = {dotAvx2<DoubleLanes>, dotRowsAvx2<DoubleLanes>,
+                                                      dotTileAvx2<DoubleLanes>};
+static const KernelTable<float> avx2FloatKernels = {dotAvx2<FloatLanes>, dotRowsAvx2<FloatLanes>,
+                                                    dotTileAvx2<FloatLanes>};
+static const KernelTable<double>& doubleKernels = useAvx2 ? avx2DoubleKernels : scalarDoubleKernels;
+static const KernelTable<float>& floatKernels = useAvx2 ? avx2FloatKernels : scalarFloatKernels;
+#else
+static const KernelTable<double>& doubleKernels = scalarDoubleKernels;
+static const KernelTable<float>& floatKernels = scalarFloatKernels;
+#endif
+
+
+/**
+ * @brief dot products of every vector against every row, one cache sized slice of rows at a time
+ */
+template <class T>
+static void dotProductsMatrix(const KernelTable<T>& kernels, const T* vecs, const int numberVecs, const T* rows,
+                              const int numberRows, const int vectorSize, T* results)
+{
+    int sliceRows = ROWS_PER_BLOCK * std::max(1, (int)(MATRIX_BLOCK_BYTES / (sizeof(T) * ROWS_PER_BLOCK *
+                                                                            std::max(1, vectorSize))));
+    for (int slice = 0; slice < numberRows; slice += sliceRows)
+    {
+        kernels.dotTile(vecs, numberVecs, rows + ((long)slice * vectorSize), std::min(sliceRows, numberRows - slice),
+                        vectorSize, results + slice, numberRows);
+    }
+}
+
+
+/**
+ * @brief dot product of 2 vectors
+ */
+double dotProduct(const double* leftVec, const double* rightVec, const int vectorSize)
+{
+    return doubleKernels.dot(leftVec, rightVec, vectorSize);
+}
+
+
+/**
+ * @brief dot product of 2 float vectors
+ */
+float dotProduct(const float* leftVec, const float* rightVec, const int vectorSize)
+{
+    return floatKernels.dot(leftVec, rightVec, vectorSize);
+}
+
+
+/**
+ * @brief euclidean norm of a vector
+ */
+double vectorNorm(const double* vec, const int vectorSize)
+{
+    return std::sqrt(doubleKernels.dot(vec, vec, vectorSize));
+}
+
+
+/**
+ * @brief euclidean norm of a float vector
+ */
+float vectorNorm(const float* vec, const int vectorSize)
+{
+    return std::sqrt(floatKernels.dot(vec, vec, vectorSize));
+}
+
+
+/**
+ * @brief dot products of one vector against consecutive rows
+ */
+void dotProducts(const double* vec, const double* rows, const int numberRows, const int vectorSize, double* results)
+{
+    doubleKernels.dotRows(vec, rows, numberRows, vectorSize, results);
+}
+
+
+/**
+ * @brief dot products of one float vector against consecutive rows
+ */
+void dotProducts(const float* vec, const float* rows, const int numberRows, const int vectorSize, float* results)
+{
+    floatKernels.dotRows(vec, rows, numberRows, vectorSize, results);
+}
+
+
+/**
+ * @brief dot products of every vector against every row
+ */
+void dotProductsMatrix(const double* vecs, const int numberVecs, const double* rows, const int numberRows,
+                       const int vectorSize, double* results)
+{
+    dotProductsMatrix(doubleKernels, vecs, numberVecs, rows, numberRows, vectorSize, results);
+}
+
+
+/**
+ * @brief dot products of every float vector against every row
+ */
+void dotProductsMatrix(const float* vecs, const int numberVecs, const float* rows, const int numberRows,
+                       const int vectorSize, float* results)
+{
+    dotProductsMatrix(floatKernels, vecs, numberVecs, rows, numberRows, vectorSize, results);
+}
+
+
+/**
+ * @brief name of the chosen kernels
+ */
+const char* vectorKernelsIsa()
+{
+    return useAvx2 ? "avx2" : "scalar";
+}
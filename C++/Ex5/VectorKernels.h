@@ -0,0 +1,81 @@
+/**
+* @file VectorKernels.h
+* @author  Jonathan Birnbaum
+* @date 18/06/2020
+*
+* @brief dot product and norm kernels, using the widest instruction set the CPU supports at run time. Every kernel
+* has a double and a float overload, the float one handling twice the values per instruction
+*/
+
+#ifndef EX5_VECTORKERNELS_H
+#define EX5_VECTORKERNELS_H
+
+/**
+ * @brief dot product of 2 vectors
+ * @param leftVec: left vector in the product
+ * @param rightVec: right vector in the product
+ * @param vectorSize: size of the vectors
+ * @return dot product result
+ */
+double dotProduct(const double* leftVec, const double* rightVec, int vectorSize);
+float dotProduct(const float* leftVec, const float* rightVec, int vectorSize);
+
+/**
+ * @brief euclidean norm of a vector
+ * @param vec: given vector
+ * @param vectorSize: size of the vector
+ * @return norm result
+ */
+double vectorNorm(const double* vec, int vectorSize);
+float vectorNorm(const float* vec, int vectorSize);
+
+/**
+ * @brief dot products of one vector against consecutive rows
+ * @param vec: vector of vectorSize values
+ * @param rows: row-major numberRows x vectorSize matrix
+ * @param numberRows: number of rows
+ * @param vectorSize: size of the vector and of every row
+ * @param results: filled with numberRows dot products
+ */
+void dotProducts(const double* vec, const double* rows, int numberRows, int vectorSize, double* results);
+void dotProducts(const float* vec, const float* rows, int numberRows, int vectorSize, float* results);
+
+/**
+ * @brief dot products of every vector against every row (a matrix product with the rows transposed), blocked so
+ * a slice of rows stays in cache while all the vectors pass over it. Every result equals the dotProducts one bit
+ * for bit
+ * @param vecs: row-major numberVecs x vectorSize matrix
+ * @param numberVecs: number of vectors
+ * @param rows: row-major numberRows x vectorSize matrix
+ * @param numberRows: number of rows
+ * @param vectorSize: size of the vectors and of the rows
+ * @param results: filled with the row-major numberVecs x numberRows products
+ */
+void dotProductsMatrix(const double* vecs, int numberVecs, const double* rows, int numberRows, int vectorSize,
+                       double* results);
+void dotProductsMatrix(const float* vecs, int numberVecs, const float* rows, int numberRows, int vectorSize,
+                       float* results);
+
+/**
+ * @brief cosine similarity of two vectors from their dot product and norms. Dividing the dot product keeps exact
+ * ties exact: two rows with the same dot product and norm score the same, which rows divided by their norm
+ * beforehand round apart
+ * @param dot: dot product of the vectors
+ * @param leftNorm: norm of the left vector
+ * @param rightNorm: norm of the right vector
+ * @return similarity, 0 if either vector is zero
+ */
+template <class Value>
+inline Value cosineSimilarity(const Value dot, const Value leftNorm, const Value rightNorm)
+{
+    Value norms = leftNorm * rightNorm;
+    return (norms > 0) ? dot / norms : 0;
+}
+
+/**
+ * @brief name of the kernels chosen for this CPU
+ * @return "avx2" or "scalar"
+ */
+const char* vectorKernelsIsa();
+
+#endif //EX5_VECTORKERNELS_H